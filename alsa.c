@@ -413,6 +413,7 @@ static int handle(struct device *dv)
         if (r < 0) {
             if (r == -EPIPE) {
                 fputs("ALSA: capture xrun.\n", stderr);
+                device_xrun(dv);
 
                 r = snd_pcm_prepare(alsa->capture.pcm);
                 if (r < 0) {
@@ -445,6 +446,7 @@ static int handle(struct device *dv)
         if (r < 0) {
             if (r == -EPIPE) {
                 fputs("ALSA: playback xrun.\n", stderr);
+                device_xrun(dv);
 
                 r = snd_pcm_prepare(alsa->playback.pcm);
                 if (r < 0) {
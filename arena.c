@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define BLOCK 65536 /* bytes, including the header */
+#define LARGE (BLOCK / 4) /* allocations given a block of their own */
+
+struct block {
+    struct block *next;
+    size_t size, used;
+    char data[];
+};
+
+void arena_init(struct arena *a)
+{
+    a->block = NULL;
+    a->allocated = 0;
+    a->blocks = 0;
+}
+
+void arena_clear(struct arena *a)
+{
+    struct block *b, *next;
+
+    for (b = a->block; b != NULL; b = next) {
+        next = b->next;
+        free(b);
+    }
+}
+
+/*
+ * Return: a new block of the given capacity, or NULL if out of memory
+ */
+
+static struct block* new_block(struct arena *a, size_t size)
+{
+    struct block *b;
+
+    b = malloc(sizeof *b + size);
+    if (b == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    b->size = size;
+    b->used = 0;
+    a->allocated += sizeof *b + size;
+    a->blocks++;
+
+    return b;
+}
+
+/*
+ * Allocate memory which lasts until the arena is cleared
+ *
+ * Pre: align is a power of two, no greater than the size of a pointer
+ * Return: pointer to memory, or NULL if out of memory
+ */
+
+void* arena_alloc(struct arena *a, size_t len, size_t align)
+{
+    struct block *b;
+    size_t start;
+
+    assert((align & (align - 1)) == 0);
+    assert(align <= sizeof(void*));
+
+    /* Large allocations go behind the current block, so as not to
+     * waste the remainder of it */
+
+    if (len > LARGE) {
+        b = new_block(a, len);
+        if (b == NULL)
+            return NULL;
+
+        if (a->block == NULL) {
+            b->next = NULL;
+            a->block = b;
+        } else {
+            b->next = a->block->next;
+            a->block->next = b;
+        }
+
+        b->used = len;
+        return b->data;
+    }
+
+    b = a->block;
+
+    if (b != NULL) {
+        start = (b->used + align - 1) & ~(align - 1);
+        if (start + len <= b->size) {
+            b->used = start + len;
+            return b->data + start;
+        }
+    }
+
+    b = new_block(a, BLOCK - sizeof *b);
+    if (b == NULL)
+        return NULL;
+
+    b->next = a->block;
+    a->block = b;
+
+    b->used = len;
+    return b->data;
+}
+
+/*
+ * Return: copy of the string, or NULL if out of memory
+ */
+
+char* arena_strdup(struct arena *a, const char *s)
+{
+    char *d;
+    size_t len;
+
+    len = strlen(s) + 1;
+
+    d = arena_alloc(a, len, 1);
+    if (d == NULL)
+        return NULL;
+
+    return memcpy(d, s, len);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Memory which is allocated in blocks, and freed all at once */
+
+struct arena {
+    struct block *block; /* the current block, or NULL */
+    size_t allocated; /* in total, bytes */
+    unsigned int blocks;
+};
+
+void arena_init(struct arena *a);
+void arena_clear(struct arena *a);
+
+void* arena_alloc(struct arena *a, size_t len, size_t align);
+char* arena_strdup(struct arena *a, const char *s);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "decimate.h"
+
+/*
+ * The largest factor which keeps the sample rate at or above the
+ * given minimum
+ *
+ * Return: factor, or 1 if the rate cannot be reduced
+ */
+
+unsigned int decimator_factor(unsigned int rate, unsigned int min_rate)
+{
+    unsigned int factor;
+
+    factor = rate / min_rate;
+
+    if (factor < 1)
+        return 1;
+    if (factor > DECIMATE_MAX)
+        return DECIMATE_MAX;
+
+    return factor;
+}
+
+/*
+ * Prepare to reduce the sample rate by the given factor
+ *
+ * A factor of 1 passes the audio through unchanged.
+ *
+ * The filter is a Hann-windowed sinc with its cutoff at the new
+ * Nyquist frequency; the timecode carrier is far below this, so the
+ * shape of the wave and the timing of its zero crossings are kept.
+ */
+
+void decimator_init(struct decimator *d, unsigned int factor)
+{
+    unsigned int n;
+    double sum, centre;
+
+    assert(factor >= 1 && factor <= DECIMATE_MAX);
+
+    d->factor = factor;
+    d->ntaps = factor * DECIMATE_TAPS;
+    d->phase = factor;
+    d->pos = 0;
+
+    centre = (d->ntaps - 1) / 2.0;
+    sum = 0.0;
+
+    for (n = 0; n < d->ntaps / 2; n++) {
+        double t, sinc, window;
+
+        t = (n - centre) / factor;
+        sinc = sin(M_PI * t) / (M_PI * t);
+        window = 0.5 - 0.5 * cos(2 * M_PI * (n + 0.5) / d->ntaps);
+
+        d->coeff[n] = sinc * window;
+        sum += 2 * d->coeff[n];
+    }
+
+    /* Unity gain for a steady level */
+
+    for (n = 0; n < d->ntaps / 2; n++)
+        d->coeff[n] /= sum;
+
+    memset(d->history, 0, sizeof d->history);
+}
+
+/*
+ * Return: the group delay of the filter, in input samples
+ */
+
+double decimator_delay(const struct decimator *d)
+{
+    if (d->factor == 1)
+        return 0.0;
+
+    return (d->ntaps - 1) / 2.0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <stdbool.h>
+
+#define DECIMATE_CHANNELS 2 /* stereo only */
+#define DECIMATE_MAX 8 /* largest factor */
+#define DECIMATE_TAPS 8 /* filter length per unit of factor; multiple of 4 */
+
+#define DECIMATE_LEN (DECIMATE_MAX * DECIMATE_TAPS)
+
+/* Low-pass filter and reduction of the sample rate by an integer
+ * factor, for stereo audio */
+
+struct decimator {
+    unsigned int factor, ntaps,
+        phase, /* input samples until the next output */
+        pos; /* most recent sample in the history */
+    float coeff[DECIMATE_LEN / 2], /* first half of a symmetrical filter */
+        history[DECIMATE_LEN * 2 * DECIMATE_CHANNELS]; /* interleaved */
+};
+
+unsigned int decimator_factor(unsigned int rate, unsigned int min_rate);
+void decimator_init(struct decimator *d, unsigned int factor);
+double decimator_delay(const struct decimator *d);
+
+/*
+ * Input one stereo sample
+ *
+ * The filter is only evaluated at the output rate; this is the same
+ * work as a polyphase decomposition, but without the bookkeeping.
+ *
+ * Return: true if an output sample is ready
+ * Post: if true, y contains the output sample
+ */
+
+static inline bool decimator_push(struct decimator *d, const signed short *x,
+                                  float *y)
+{
+    unsigned int n, ntaps;
+    const float *lo, *hi;
+    float l0, r0, l1, r1;
+
+    if (d->factor == 1) {
+        y[0] = x[0];
+        y[1] = x[1];
+        return true;
+    }
+
+    ntaps = d->ntaps;
+
+    /* History is written twice so that the most recent ntaps
+     * samples are always contiguous */
+
+    if (++d->pos == ntaps)
+        d->pos = 0;
+
+    d->history[d->pos * 2] = x[0];
+    d->history[d->pos * 2 + 1] = x[1];
+    d->history[(d->pos + ntaps) * 2] = x[0];
+    d->history[(d->pos + ntaps) * 2 + 1] = x[1];
+
+    if (--d->phase > 0)
+        return false;
+
+    d->phase = d->factor;
+
+    /* Fold the symmetrical filter, working inwards from the oldest
+     * and newest samples. Two sums per channel shorten the chain of
+     * dependent additions. */
+
+    lo = &d->history[(d->pos + 1) * 2];
+    hi = &d->history[(d->pos + ntaps) * 2];
+    l0 = r0 = l1 = r1 = 0.0;
+
+    for (n = 0; n < ntaps / 2; n += 2) {
+        l0 += d->coeff[n] * (lo[0] + hi[0]);
+        r0 += d->coeff[n] * (lo[1] + hi[1]);
+        l1 += d->coeff[n + 1] * (lo[2] + hi[-2]);
+        r1 += d->coeff[n + 1] * (lo[3] + hi[-1]);
+        lo += 4;
+        hi -= 4;
+    }
+
+    y[0] = l0 + l1;
+    y[1] = r0 + r1;
+
+    return true;
+}
+
+#endif
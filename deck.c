@@ -46,7 +46,7 @@ static const struct record no_record = {
 
 int deck_init(struct deck *d, struct rt *rt,
               struct timecode_def *timecode, const char *importer,
-              double speed, bool phono, bool protect)
+              double speed, bool phono, bool decimate, bool protect)
 {
     unsigned int rate;
 
@@ -61,7 +61,7 @@ int deck_init(struct deck *d, struct rt *rt,
     d->importer = importer;
     rate = device_sample_rate(&d->device);
     assert(timecode != NULL);
-    timecoder_init(&d->timecoder, timecode, speed, rate, phono);
+    timecoder_init(&d->timecoder, timecode, speed, rate, phono, decimate);
     player_init(&d->player, rate, track_acquire_empty(), &d->timecoder);
     cues_reset(&d->cues);
 
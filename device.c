@@ -19,17 +19,25 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "debug.h"
 #include "device.h"
 #include "player.h"
 #include "timecoder.h"
+#include "trace.h"
 
 void device_init(struct device *dv, struct device_ops *ops)
 {
     debug("%p", dv);
     dv->fault = false;
     dv->ops = ops;
+
+    memset(&dv->acc, 0, sizeof dv->acc);
+    dv->stats = dv->acc;
+    dv->stats_seq = 0;
 }
 
 /*
@@ -100,6 +108,29 @@ ssize_t device_pollfds(struct device *dv, struct pollfd *pe, size_t z)
         return 0;
 }
 
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Make the counters available to other threads
+ */
+
+static void publish_stats(struct device *dv)
+{
+    dv->stats_seq++;
+    __sync_synchronize();
+    dv->stats = dv->acc;
+    __sync_synchronize();
+    dv->stats_seq++;
+}
+
 /*
  * Handle any available input or output on the device
  *
@@ -109,16 +140,31 @@ ssize_t device_pollfds(struct device *dv, struct pollfd *pe, size_t z)
 
 void device_handle(struct device *dv)
 {
+    double start, busy;
+
     if (dv->fault)
         return;
 
     if (dv->ops->handle == NULL)
         return;
 
+    trace_begin("device_handle");
+    start = now();
+
     if (dv->ops->handle(dv) != 0) {
         dv->fault = true;
         fputs("Error handling audio device; disabling it\n", stderr);
     }
+
+    busy = now() - start;
+
+    dv->acc.cycles++;
+    dv->acc.busy += busy;
+    if (busy > dv->acc.worst)
+        dv->acc.worst = busy;
+
+    publish_stats(dv);
+    trace_end("device_handle");
 }
 
 /*
@@ -144,3 +190,29 @@ void device_collect(struct device *dv, signed short *pcm, size_t n)
     assert(dv->player != NULL);
     player_collect(dv->player, pcm, n);
 }
+
+/*
+ * Account for a buffer under or overrun, from the thread which
+ * handles the device; it is published at the end of the cycle
+ */
+
+void device_xrun(struct device *dv)
+{
+    dv->acc.xruns++;
+}
+
+/*
+ * Get the counters for this device, from any thread
+ */
+
+void device_get_stats(struct device *dv, struct device_stats *s)
+{
+    unsigned int seq;
+
+    do {
+        seq = dv->stats_seq;
+        __sync_synchronize();
+        *s = dv->stats;
+        __sync_synchronize();
+    } while (seq % 2 || seq != dv->stats_seq);
+}
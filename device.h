@@ -26,6 +26,16 @@
 
 #define DEVICE_CHANNELS 2
 
+/* Counters of the realtime handling of a device, since it was
+ * initialised */
+
+struct device_stats {
+    unsigned long cycles, /* calls to handle the device */
+        xruns; /* buffer under or overruns */
+    double busy, /* seconds spent handling the device */
+        worst; /* longest time for a single cycle, in seconds */
+};
+
 struct device {
     bool fault;
     void *local;
@@ -33,6 +43,12 @@ struct device {
 
     struct timecoder *timecoder;
     struct player *player;
+
+    /* 'acc' is private to the realtime thread, and is copied to
+     * 'stats' at the end of each cycle for other threads */
+
+    struct device_stats acc, stats;
+    unsigned int stats_seq; /* odd whilst stats are being written */
 };
 
 struct device_ops {
@@ -63,4 +79,7 @@ void device_handle(struct device *dv);
 void device_submit(struct device *dv, signed short *pcm, size_t npcm);
 void device_collect(struct device *dv, signed short *pcm, size_t npcm);
 
+void device_xrun(struct device *dv);
+void device_get_stats(struct device *dv, struct device_stats *s);
+
 #endif
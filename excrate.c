@@ -24,56 +24,210 @@
  * back into a local listing.
  */
 
+#define _GNU_SOURCE /* asprintf() */
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "excrate.h"
 #include "rig.h"
+#include "scanner.h"
 #include "status.h"
 
+#define BATCH 1024
+
 static struct list excrates = LIST_INIT(excrates);
 
-static int excrate_init(struct excrate *e, const char *script,
-                        const char *search, struct listing *storage)
+/*
+ * Write the pathnames of a listing to a temporary file, for the scan
+ * to compare against
+ *
+ * Return: pathname of the file with responsibility, or NULL on error
+ */
+
+static char* write_manifest(const struct listing *l)
+{
+    char *pathname;
+    const char *tmpdir;
+    size_t n;
+    int fd;
+    FILE *f;
+
+    tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL)
+        tmpdir = "/tmp";
+
+    if (asprintf(&pathname, "%s/xwax-manifest-XXXXXX", tmpdir) == -1) {
+        perror("asprintf");
+        return NULL;
+    }
+
+    fd = mkstemp(pathname);
+    if (fd == -1) {
+        perror("mkstemp");
+        free(pathname);
+        return NULL;
+    }
+
+    f = fdopen(fd, "w");
+    if (f == NULL) {
+        perror("fdopen");
+        if (close(fd) == -1)
+            abort();
+        goto fail;
+    }
+
+    for (n = 0; n < l->by_order.entries; n++)
+        fprintf(f, "%s\n", l->by_order.record[n]->pathname);
+
+    if (fclose(f) == EOF) {
+        perror("fclose");
+        goto fail;
+    }
+
+    return pathname;
+
+fail:
+    if (unlink(pathname) == -1)
+        perror("unlink");
+    free(pathname);
+    return NULL;
+}
+
+/*
+ * Remove the manifest, if there is one
+ */
+
+static void remove_manifest(struct excrate *e)
+{
+    if (e->manifest == NULL)
+        return;
+
+    if (unlink(e->manifest) == -1)
+        perror("unlink");
+
+    free(e->manifest);
+    e->manifest = NULL;
+}
+
+/*
+ * Return: true if the scan has not yet been waited for
+ */
+
+static bool is_running(const struct excrate *e)
 {
-    pid_t pid;
+    return e->pid != 0 || e->scanner != NULL;
+}
 
-    fprintf(stderr, "External scan '%s'...\n", search);
+/*
+ * Start the scan script, or the built-in scanner in its place
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int launch(struct excrate *e, const char *script, const char *search)
+{
+    e->pid = 0;
+    e->scanner = NULL;
+
+    if (strcmp(script, SCANNER_BUILTIN) == 0) {
+        e->scanner = scanner_start(search, e->manifest, &e->fd);
+        if (e->scanner == NULL)
+            return -1;
+
+        return 0;
+    }
 
-    pid = fork_pipe_nb(&e->fd, script, "scan", search, NULL);
-    if (pid == -1)
+    if (e->manifest != NULL) {
+        e->pid = fork_pipe_nb(&e->fd, script, "scan", search, e->manifest,
+                              NULL);
+    } else {
+        e->pid = fork_pipe_nb(&e->fd, script, "scan", search, NULL);
+    }
+
+    if (e->pid == -1) {
+        e->pid = 0;
         return -1;
+    }
+
+    return 0;
+}
+
+static int excrate_init(struct excrate *e, const char *script,
+                        const char *search, struct listing *storage,
+                        const struct listing *base)
+{
+    listing_init(&e->listing);
+    e->manifest = NULL;
+
+    if (base != NULL) {
+        fprintf(stderr, "External scan '%s' for changes...\n", search);
+
+        if (listing_copy(&e->listing, base) == -1)
+            goto fail;
+
+        e->manifest = write_manifest(base);
+        if (e->manifest == NULL)
+            goto fail;
+    } else {
+        fprintf(stderr, "External scan '%s'...\n", search);
+    }
+
+    if (launch(e, script, search) == -1)
+        goto fail;
 
-    e->pid = pid;
     e->pe = NULL;
     e->terminated = false;
+    e->succeeded = false;
     e->refcount = 0;
     rb_reset(&e->rb);
-    listing_init(&e->listing);
     e->storage = storage;
     event_init(&e->completion);
     e->search = search;
+    e->records = 0;
+    e->added = 0;
+    e->removed = 0;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &e->start) == -1)
+        abort();
 
     list_add(&e->excrates, &excrates);
     rig_post_excrate(e);
 
     return 0;
+
+fail:
+    remove_manifest(e);
+    listing_clear(&e->listing);
+    return -1;
 }
 
 static void excrate_clear(struct excrate *e)
 {
-    assert(e->pid == 0);
+    assert(!is_running(e));
+    assert(e->manifest == NULL);
     list_del(&e->excrates);
     listing_clear(&e->listing);
     event_clear(&e->completion);
 }
 
+/*
+ * Start a scan, or an update of the listing of a previous scan if
+ * base is given; in which case the listing begins as a copy of base
+ * and only the differences are applied
+ *
+ * Return: excrate with a reference, or NULL on error
+ */
+
 struct excrate* excrate_acquire_by_scan(const char *script, const char *search,
-                                        struct listing *storage)
+                                        struct listing *storage,
+                                        const struct listing *base)
 {
     struct excrate *e;
 
@@ -85,7 +239,7 @@ struct excrate* excrate_acquire_by_scan(const char *script, const char *search,
         return NULL;
     }
 
-    if (excrate_init(e, script, search, storage) == -1) {
+    if (excrate_init(e, script, search, storage, base) == -1) {
         free(e);
         return NULL;
     }
@@ -108,11 +262,16 @@ void excrate_acquire(struct excrate *e)
 
 static void terminate(struct excrate *e)
 {
-    assert(e->pid != 0);
-    debug("terminating %d", e->pid);
+    assert(is_running(e));
 
-    if (kill(e->pid, SIGTERM) == -1)
-        abort();
+    if (e->scanner != NULL) {
+        debug("terminating scanner %p", e->scanner);
+        scanner_cancel(e->scanner);
+    } else {
+        debug("terminating %d", e->pid);
+        if (kill(e->pid, SIGTERM) == -1)
+            abort();
+    }
 
     e->terminated = true;
 }
@@ -124,7 +283,7 @@ void excrate_release(struct excrate *e)
 
     /* Scan must terminate before this object goes away */
 
-    if (e->refcount == 1 && e->pid != 0) {
+    if (e->refcount == 1 && is_running(e)) {
         debug("%p still executing but not longer required", e);
         terminate(e);
         return;
@@ -145,7 +304,7 @@ void excrate_release(struct excrate *e)
 
 void excrate_pollfd(struct excrate *e, struct pollfd *pe)
 {
-    assert(e->pid != 0);
+    assert(is_running(e));
 
     pe->fd = e->fd;
     pe->events = POLLIN;
@@ -155,75 +314,166 @@ void excrate_pollfd(struct excrate *e, struct pollfd *pe)
 
 static void do_wait(struct excrate *e)
 {
+    bool update, ok;
     int status;
+    struct timespec now;
+    double elapsed;
 
-    assert(e->pid != 0);
-    debug("waiting on pid %d", e->pid);
+    assert(is_running(e));
 
     if (close(e->fd) == -1)
         abort();
 
-    if (waitpid(e->pid, &status, 0) == -1)
-        abort();
+    if (e->scanner != NULL) {
+        scanner_cancel(e->scanner); /* in case of an error reading */
+        status = scanner_join(e->scanner);
+        ok = (status == 0);
+        e->scanner = NULL;
+    } else {
+        debug("waiting on pid %d", e->pid);
 
-    debug("wait for pid %d returned %d", e->pid, status);
+        if (waitpid(e->pid, &status, 0) == -1)
+            abort();
+
+        debug("wait for pid %d returned %d", e->pid, status);
+        ok = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+        e->pid = 0;
+    }
 
-    if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
-        fprintf(stderr, "Scan completed\n");
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == -1)
+        abort();
+
+    elapsed = (now.tv_sec - e->start.tv_sec)
+        + (now.tv_nsec - e->start.tv_nsec) / 1e9;
+
+    update = (e->manifest != NULL);
+    remove_manifest(e);
+
+    if (ok) {
+        e->succeeded = true;
+        fprintf(stderr, "Scan completed, %zu records in %.1fs (%.0f/s)\n",
+                e->records, elapsed, e->records / elapsed);
+        fprintf(stderr, "Library has %zu records, %zu artists, "
+                "%.1fMiB in %u allocations\n",
+                e->storage->by_order.entries, e->storage->artists.entries,
+                e->storage->arena.allocated / 1048576.0,
+                e->storage->arena.blocks);
+
+        if (update) {
+            status_printf(STATUS_INFO, "Rescan of %s: %zu added, %zu removed",
+                          e->search, e->added, e->removed);
+        }
     } else {
         fprintf(stderr, "Scan completed with status %d\n", status);
         if (!e->terminated)
             status_printf(STATUS_ALERT, "Error scanning %s", e->search);
     }
+}
 
-    e->pid = 0;
+/*
+ * Apply a batch of changes from the scan to the storage and our
+ * listing; removals first, as they come first from the scan
+ *
+ * Return: -1 if out of memory, otherwise zero
+ */
+
+static int add_batch(struct excrate *e, struct record **x, size_t n,
+                     struct record **y, size_t m)
+{
+    size_t before;
+
+    before = e->listing.by_order.entries;
+
+    if (listing_remove_batch(&e->listing, y, m) == -1)
+        return -1;
+
+    e->removed += before - e->listing.by_order.entries;
+    before = e->listing.by_order.entries;
+
+    if (listing_add_batch(e->storage, x, n) == -1)
+        return -1;
+
+    if (listing_add_batch(&e->listing, x, n) == -1)
+        return -1;
+
+    e->added += e->listing.by_order.entries - before;
+    e->records += n;
+    return 0;
 }
 
 /*
+ * Read the available records; these are sorted and merged into the
+ * listings as a batch, which is much faster than adding them one at
+ * a time
+ *
+ * Everything available is read, up to the end of the pipe, in
+ * batches of up to BATCH records; each batch is one notification to
+ * observers of the listings, so a backlog gives several in one pass.
+ *
+ * An update also gives records which have been removed since, as
+ * lines with a prefix of "-\t".
+ *
  * Return: -1 on completion, otherwise zero
  */
 
 static int read_from_pipe(struct excrate *e)
 {
+    size_t n, m;
+    struct record *d[BATCH], *g[BATCH];
+
+    n = 0;
+    m = 0;
+
     for (;;) {
         char *line;
         ssize_t z;
-        struct record *d, *x;
+
+        if (n == BATCH || m == BATCH) {
+            if (add_batch(e, d, n, g, m) == -1)
+                return -1;
+            n = 0;
+            m = 0;
+        }
 
         z = get_line(e->fd, &e->rb, &line);
         if (z == -1) {
             if (errno == EAGAIN)
-                return 0;
+                break;
             perror("get_line");
-            return -1;
         }
 
-        if (z == 0)
+        if (z <= 0) { /* completion, or error */
+            add_batch(e, d, n, g, m);
             return -1;
+        }
 
         debug("got line '%s'", line);
 
-        d = get_record(line);
-        if (d == NULL) {
-            free(line);
-            continue; /* ignore malformed entries */
+        if (e->manifest != NULL && line[0] == '-' && line[1] == '\t') {
+            g[m] = lookup_record(&e->listing, line + 2);
+
+            if (g[m] != NULL) /* otherwise already gone */
+                m++;
+            continue;
         }
 
-        x = listing_add(e->storage, d);
-        if (x == NULL)
-            return -1;
-        if (x != d) /* our new record is a duplicate */
-            free(d);
+        d[n] = get_record(e->storage, line);
 
-        x = listing_add(&e->listing, x);
-        if (x == NULL)
-            return -1;
+        if (d[n] == NULL)
+            continue; /* ignore malformed entries */
+
+        n++;
     }
+
+    if (add_batch(e, d, n, g, m) == -1)
+        return -1;
+
+    return 0;
 }
 
 void excrate_handle(struct excrate *e)
 {
-    assert(e->pid != 0);
+    assert(is_running(e));
 
     if (e->pe == NULL)
         return;
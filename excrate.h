@@ -22,6 +22,7 @@
 
 #include <poll.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "external.h"
 #include "list.h"
@@ -38,18 +39,27 @@ struct excrate {
     /* State of the external scan process */
 
     struct list rig;
-    pid_t pid;
+    pid_t pid; /* or 0 */
+    struct scanner *scanner; /* or NULL, if built-in */
     int fd;
     struct pollfd *pe;
-    bool terminated;
+    bool terminated, succeeded;
 
     /* State of reader */
 
     struct rb rb;
+    size_t records;
+    struct timespec start;
+
+    /* An update applies only the changes since a previous scan */
+
+    char *manifest; /* or NULL if not an update */
+    size_t added, removed;
 };
 
 struct excrate* excrate_acquire_by_scan(const char *script, const char *search,
-                                        struct listing *storage);
+                                        struct listing *storage,
+                                        const struct listing *base);
 
 void excrate_acquire(struct excrate *e);
 void excrate_release(struct excrate *e);
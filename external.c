@@ -203,18 +203,18 @@ fail:
 
 void rb_reset(struct rb *rb)
 {
+    rb->start = 0;
     rb->len = 0;
-}
-
-bool rb_is_full(const struct rb *rb)
-{
-    return (rb->len == sizeof rb->buf);
+    rb->scanned = 0;
 }
 
 /*
  * Read, within reasonable limits (ie. memory or time)
  * from the fd into the buffer
  *
+ * The unread data is first moved to the front of the buffer; this
+ * happens once for each read, rather than for each line.
+ *
  * Return: -1 on error, 0 on EOF, otherwise the number of bytes added
  */
 
@@ -223,7 +223,16 @@ static ssize_t top_up(struct rb *rb, int fd)
     size_t remain;
     ssize_t z;
 
-    assert(rb->len < sizeof rb->buf);
+    if (rb->start > 0) {
+        memmove(rb->buf, rb->buf + rb->start, rb->len);
+        rb->start = 0;
+    }
+
+    if (rb->len == sizeof rb->buf) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
     remain = sizeof(rb->buf) - rb->len;
 
     z = read(fd, rb->buf + rb->len, remain);
@@ -235,41 +244,39 @@ static ssize_t top_up(struct rb *rb, int fd)
 }
 
 /*
- * Pop the front of the buffer to end-of-line
+ * Pop the front of the buffer to end-of-line, which is terminated
+ * in place
  *
- * Return: 0 if not found, -1 if not enough memory,
- *    otherwise string length (incl. terminator)
- * Post: if return is > 0, q points to alloc'd string
+ * Return: 0 if not found, otherwise string length (incl. terminator)
+ * Post: if return is > 0, q points to the string in the buffer
  */
 
 static ssize_t pop(struct rb *rb, char **q)
 {
-    const char *x;
-    char *s;
+    char *s, *x;
     size_t len;
 
-    x = memchr(rb->buf, '\n', rb->len);
+    s = rb->buf + rb->start;
+
+    /* Don't search again the part already known not to contain a
+     * line ending */
+
+    x = memchr(s + rb->scanned, '\n', rb->len - rb->scanned);
     if (!x) {
         debug("pop %p exhausted", rb);
+        rb->scanned = rb->len;
         return 0;
     }
 
-    len = x - rb->buf;
+    len = x - s;
     debug("pop %p got %u", rb, len);
 
-    s = strndup(rb->buf, len);
-    if (!s) {
-        debug("strndup: %s", strerror(errno));
-        return -1;
-    }
-
+    *x = '\0';
     *q = s;
 
-    /* Simple compact of the buffer. If this is a bottleneck of any
-     * kind (unlikely) then a circular buffer should be used */
-
-    memmove(rb->buf, x + 1, rb->len - len - 1);
-    rb->len = rb->len - len - 1;
+    rb->start += len + 1;
+    rb->len -= len + 1;
+    rb->scanned = 0;
 
     return len + 1;
 }
@@ -278,11 +285,16 @@ static ssize_t pop(struct rb *rb, char **q)
  * Read a terminated string from the given file descriptor via
  * the buffer.
  *
+ * The buffer is only topped up from the file descriptor once it
+ * has no complete line; so a large buffer gives many lines for
+ * each read().
+ *
  * Handles non-blocking file descriptors too. If fd is non-blocking,
  * then the semantics are the same as a non-blocking read() --
  * ie. EAGAIN may be returned as an error.
  *
  * Return: 0 on EOF, or -1 on error
+ * Post: if > 0 is returned, *string is valid until the next call
  * Post: if -1 is returned, errno is set accordingly
  */
 
@@ -290,6 +302,10 @@ ssize_t get_line(int fd, struct rb *rb, char **string)
 {
     ssize_t y, z;
 
+    z = pop(rb, string);
+    if (z != 0)
+        return z;
+
     y = top_up(rb, fd);
     if (y < 0)
         return y;
@@ -298,12 +314,10 @@ ssize_t get_line(int fd, struct rb *rb, char **string)
     if (z != 0)
         return z;
 
-    if (rb_is_full(rb))
-        errno = ENOBUFS;
-    else if (y > 0)
+    if (y > 0)
         errno = EAGAIN;
     else
-        return 0; /* true EOF: no more data and empty buffer */
+        return 0; /* true EOF: no complete line remains */
 
     return -1;
 }
@@ -29,12 +29,13 @@
 
 /*
  * A handy read buffer; an equivalent of fread() but for
- * non-blocking file descriptors
+ * non-blocking file descriptors. Lines are returned in place.
  */
 
 struct rb {
-    char buf[4096];
-    size_t len;
+    char buf[65536];
+    size_t start, len, /* the unread data */
+        scanned; /* of which, known to have no line ending */
 };
 
 pid_t fork_pipe(int *fd, const char *path, char *arg, ...);
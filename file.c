@@ -0,0 +1,471 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Audio device which reads and writes files, as quickly as possible
+ *
+ * For offline runs of the timecoder and player; eg. a benchmark, or
+ * to repeat a recording of a real session.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "rig.h"
+
+#define DEFAULT_RATE 44100
+
+#define FRAME (DEVICE_CHANNELS * sizeof(signed short)) /* bytes */
+
+struct file {
+    int in, out, /* or -1 for no output */
+        wake[2]; /* polled after the end of input, until stopped */
+    struct pollfd *pe;
+    unsigned int rate;
+    bool finished;
+
+    size_t period, fill; /* in bytes */
+    signed short *pcm;
+};
+
+static unsigned int running; /* devices yet to reach the end of input */
+
+static void clear(struct device *dv)
+{
+    struct file *f = dv->local;
+
+    if (close(f->in) == -1)
+        abort();
+
+    if (f->out != -1 && close(f->out) == -1)
+        perror("close");
+
+    if (close(f->wake[0]) == -1 || close(f->wake[1]) == -1)
+        abort();
+
+    free(f->pcm);
+    free(f);
+}
+
+/*
+ * Read from the input until a period is full, or the end
+ *
+ * Return: 0 if there is more to come, 1 at the end, or -1 on error
+ */
+
+static int pull(struct file *f)
+{
+    ssize_t z;
+
+    if (f->fill >= f->period)
+        return 0; /* already full */
+
+    z = read(f->in, (char*)f->pcm + f->fill, f->period - f->fill);
+    if (z == -1) {
+        if (errno == EINTR || errno == EAGAIN)
+            return 0;
+        perror("read");
+        return -1;
+    }
+
+    f->fill += z;
+
+    return z == 0 ? 1 : 0;
+}
+
+static int push(int fd, const void *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t z;
+
+        z = write(fd, buf, len);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("write");
+            return -1;
+        }
+
+        buf = (const char*)buf + z;
+        len -= z;
+    }
+
+    return 0;
+}
+
+/*
+ * Process a whole period, including a partial one at the end of the
+ * input
+ */
+
+static int period(struct device *dv, struct file *f)
+{
+    size_t n;
+
+    n = f->fill / FRAME;
+    f->fill = 0;
+
+    if (n == 0)
+        return 0;
+
+    device_submit(dv, f->pcm, n);
+    device_collect(dv, f->pcm, n);
+
+    if (f->out != -1 && push(f->out, f->pcm, n * FRAME) == -1)
+        return -1;
+
+    return 0;
+}
+
+static int handle(struct device *dv)
+{
+    int r;
+    struct file *f = dv->local;
+
+    if (f->finished)
+        return 0;
+
+    if (!(f->pe->revents & (POLLIN | POLLHUP)))
+        return 0;
+
+    r = pull(f);
+    if (r == -1)
+        return -1;
+
+    if (r == 0 && f->fill < f->period)
+        return 0; /* wait for the remainder */
+
+    if (period(dv, f) == -1)
+        return -1;
+
+    if (r == 1) {
+        f->finished = true;
+        fprintf(stderr, "End of input to file device\n");
+
+        /* The input remains readable at its end, so poll instead
+         * something which is not, and which does not hold up other
+         * devices; it only wakes the realtime thread to stop */
+
+        f->pe->fd = f->wake[0];
+
+        /* The run is over when every input is */
+
+        if (__sync_sub_and_fetch(&running, 1) == 0 && rig_quit() == -1)
+            return -1;
+    }
+
+    return 0;
+}
+
+static ssize_t pollfds(struct device *dv, struct pollfd *pe, size_t z)
+{
+    struct file *f = dv->local;
+
+    if (z < 1)
+        return -1;
+
+    pe->fd = f->in;
+    pe->events = POLLIN;
+    f->pe = pe;
+
+    return 1;
+}
+
+/*
+ * Wake the realtime thread, which may be waiting on nothing but
+ * devices at the end of their input
+ */
+
+static void stop(struct device *dv)
+{
+    struct file *f = dv->local;
+
+    if (write(f->wake[1], "", 1) == -1)
+        perror("write");
+}
+
+static unsigned int sample_rate(struct device *dv)
+{
+    struct file *f = dv->local;
+
+    return f->rate;
+}
+
+static struct device_ops file_ops = {
+    .pollfds = pollfds,
+    .handle = handle,
+    .sample_rate = sample_rate,
+    .stop = stop,
+    .clear = clear
+};
+
+static unsigned long le(const unsigned char *p, size_t n)
+{
+    unsigned long v;
+
+    v = 0;
+    while (n-- > 0)
+        v = v << 8 | p[n];
+
+    return v;
+}
+
+/*
+ * Read exactly the given number of bytes
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int get(int fd, void *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t z;
+
+        z = read(fd, buf, len);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("read");
+            return -1;
+        }
+        if (z == 0) {
+            fprintf(stderr, "Unexpected end of WAV file\n");
+            return -1;
+        }
+
+        buf = (char*)buf + z;
+        len -= z;
+    }
+
+    return 0;
+}
+
+/*
+ * Read the header of a WAV file, up to the start of its audio
+ *
+ * Pre: the "RIFF" and "WAVE" identifiers have been read
+ * Return: 0 on success, otherwise -1
+ */
+
+static int wav_header(struct file *f)
+{
+    unsigned char c[16];
+    bool format;
+
+    format = false;
+
+    for (;;) {
+        unsigned long len;
+
+        if (get(f->in, c, 8) == -1)
+            return -1;
+
+        len = le(c + 4, 4);
+
+        if (!memcmp(c, "data", 4))
+            break;
+
+        if (!memcmp(c, "fmt ", 4)) {
+            unsigned int tag, channels, bits;
+
+            if (len < sizeof c) {
+                fprintf(stderr, "WAV format is too short\n");
+                return -1;
+            }
+
+            if (get(f->in, c, sizeof c) == -1)
+                return -1;
+            len -= sizeof c;
+
+            tag = le(c, 2);
+            channels = le(c + 2, 2);
+            f->rate = le(c + 4, 4);
+            bits = le(c + 14, 2);
+
+            /* Extensible format is accepted without checking its
+             * sub-format */
+
+            if ((tag != 1 && tag != 0xfffe) || channels != DEVICE_CHANNELS
+                || bits != 16)
+            {
+                fprintf(stderr, "WAV file must be 16-bit PCM with %d "
+                        "channels\n", DEVICE_CHANNELS);
+                return -1;
+            }
+
+            format = true;
+        }
+
+        /* Skip the rest of the chunk, which is padded to an even
+         * length */
+
+        len += len & 1;
+
+        while (len > 0) {
+            size_t n;
+
+            n = len < sizeof c ? len : sizeof c;
+            if (get(f->in, c, n) == -1)
+                return -1;
+            len -= n;
+        }
+    }
+
+    if (!format) {
+        fprintf(stderr, "WAV file has no format before its data\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Identify a WAV file, or otherwise treat the start of the input as
+ * raw audio
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int open_input(struct file *f)
+{
+    unsigned char c[12];
+
+    while (f->fill < sizeof c) {
+        ssize_t z;
+
+        z = read(f->in, c + f->fill, sizeof c - f->fill);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("read");
+            return -1;
+        }
+        if (z == 0)
+            break;
+
+        f->fill += z;
+    }
+
+    if (f->fill == sizeof c && !memcmp(c, "RIFF", 4)
+        && !memcmp(c + 8, "WAVE", 4))
+    {
+        f->fill = 0;
+        return wav_header(f);
+    }
+
+    /* Keep what was read as the start of the first period; the input
+     * may not be seekable */
+
+    memcpy(f->pcm, c, f->fill);
+    return 0;
+}
+
+/*
+ * Create a device which reads from a WAV file, or raw signed 16-bit
+ * stereo audio, and optionally writes the output as raw audio
+ *
+ * The audio is processed as quickly as the input is available, in
+ * periods of the given number of samples. When the input of every
+ * file device has ended the program is asked to quit.
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+int file_init(struct device *dv, const char *input, const char *output,
+              unsigned int rate, unsigned int samples)
+{
+    struct file *f;
+
+    if (samples == 0) {
+        fprintf(stderr, "File device period must be at least one sample\n");
+        return -1;
+    }
+
+    f = malloc(sizeof *f);
+    if (f == NULL) {
+        perror("malloc");
+        return -1;
+    }
+
+    f->pe = NULL;
+    f->rate = rate ? rate : DEFAULT_RATE;
+    f->finished = false;
+    f->period = samples * FRAME;
+    f->fill = 0;
+
+    /* The header of a WAV file is smaller than a period is allowed
+     * to be */
+
+    f->pcm = malloc(f->period < 12 ? 12 : f->period);
+    if (f->pcm == NULL) {
+        perror("malloc");
+        goto fail;
+    }
+
+    f->in = open(input, O_RDONLY | O_CLOEXEC);
+    if (f->in == -1) {
+        perror(input);
+        goto fail_pcm;
+    }
+
+    if (open_input(f) == -1)
+        goto fail_in;
+
+    if (output == NULL) {
+        f->out = -1;
+    } else {
+        f->out = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (f->out == -1) {
+            perror(output);
+            goto fail_in;
+        }
+    }
+
+    if (pipe(f->wake) == -1) {
+        perror("pipe");
+        goto fail_out;
+    }
+
+    fprintf(stderr, "File device at %uHz, %u sample periods\n",
+            f->rate, samples);
+
+    device_init(dv, &file_ops);
+    dv->local = f;
+    running++;
+
+    return 0;
+
+fail_out:
+    if (f->out != -1 && close(f->out) == -1)
+        perror("close");
+fail_in:
+    if (close(f->in) == -1)
+        abort();
+fail_pcm:
+    free(f->pcm);
+fail:
+    free(f);
+    return -1;
+}
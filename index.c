@@ -25,9 +25,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "index.h"
+#include "pool.h"
+#include "trace.h"
 
 #define BLOCK 1024
+#define PARALLEL 16384 /* entries worth giving to a thread */
+#define KEY_PAD 16 /* bytes after a key, so it can be read as a vector */
 #define MAX_WORDS 32
 #define SEPARATOR ' '
 
@@ -186,6 +194,113 @@ static bool record_match_word(struct record *re, const char *match)
     return false;
 }
 
+/*
+ * Give the record a key for searching, allocated from the arena
+ *
+ * The key is the same text which record_match_word() searches,
+ * case-folded in the same way as strcasestr(). Artist and title are
+ * separated by a terminator which cannot be part of a search word,
+ * and the key is padded so it can be read in whole vectors.
+ *
+ * Return: 0 on success, or -1 on memory allocation failure
+ */
+
+int record_key(struct record *re, struct arena *a)
+{
+    char *k;
+    const char *s;
+    size_t n;
+
+    if (re->match)
+        n = strlen(re->match);
+    else
+        n = strlen(re->artist) + 1 + strlen(re->title);
+
+    k = arena_alloc(a, n + KEY_PAD, 1);
+    if (k == NULL)
+        return -1;
+
+    re->key = k;
+    re->keylen = n;
+
+    if (re->match) {
+        for (s = re->match; *s != '\0'; s++)
+            *k++ = tolower((unsigned char)*s);
+    } else {
+        for (s = re->artist; *s != '\0'; s++)
+            *k++ = tolower((unsigned char)*s);
+        *k++ = '\0';
+        for (s = re->title; *s != '\0'; s++)
+            *k++ = tolower((unsigned char)*s);
+    }
+
+    memset(k, '\0', KEY_PAD);
+    return 0;
+}
+
+/*
+ * Search a record's key for a case-folded word
+ *
+ * Positions where both the first and last characters of the word
+ * match are found for a vector of positions at once, and only these
+ * are compared in full.
+ *
+ * Pre: key is padded by KEY_PAD
+ * Return: true if the key contains the word, otherwise false
+ */
+
+static bool key_contains(const char *key, size_t n, const char *w, size_t k)
+{
+    size_t i;
+
+    if (k == 0)
+        return true;
+    if (k > n)
+        return false;
+    if (k == 1)
+        return memchr(key, w[0], n) != NULL;
+
+#ifdef __SSE2__
+    {
+        __m128i first, last;
+
+        first = _mm_set1_epi8(w[0]);
+        last = _mm_set1_epi8(w[k - 1]);
+
+        for (i = 0; i + k <= n; i += 16) {
+            __m128i a, b;
+            unsigned int mask;
+            size_t limit;
+
+            a = _mm_loadu_si128((const __m128i*)(key + i));
+            b = _mm_loadu_si128((const __m128i*)(key + i + k - 1));
+            mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                   _mm_cmpeq_epi8(b, last)));
+
+            limit = n - k - i + 1; /* positions within the key */
+            if (limit < 16)
+                mask &= (1u << limit) - 1;
+
+            while (mask != 0) {
+                if (memcmp(key + i + __builtin_ctz(mask) + 1, w + 1, k - 2) == 0)
+                    return true;
+                mask &= mask - 1;
+            }
+        }
+    }
+#else
+    for (i = 0; i + k <= n; i++) {
+        if (key[i] == w[0] && key[i + k - 1] == w[k - 1]
+            && memcmp(key + i + 1, w + 1, k - 2) == 0)
+        {
+            return true;
+        }
+    }
+#endif
+
+    return false;
+}
+
 /*
  * Check for a match against the given search criteria
  *
@@ -194,8 +309,20 @@ static bool record_match_word(struct record *re, const char *match)
 
 bool record_match(struct record *re, const struct match *h)
 {
+    size_t n;
     char *const *matches;
 
+    if (re->key) {
+        for (n = 0; h->words[n] != NULL; n++) {
+            if (!key_contains(re->key, re->keylen,
+                              h->folded + (h->words[n] - h->buf), h->len[n]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     matches = h->words;
 
     while (*matches != NULL) {
@@ -262,13 +389,99 @@ void match_compile(struct match *h, const char *d)
         buf = s + 1; /* skip separator */
     }
     h->words[n] = NULL; /* terminate list */
+
+    /* Case-fold the words, for matching against record keys */
+
+    for (n = 0; h->words[n] != NULL; n++) {
+        size_t i;
+        char *f;
+
+        f = h->folded + (h->words[n] - h->buf);
+        h->len[n] = strlen(h->words[n]);
+
+        for (i = 0; i <= h->len[n]; i++)
+            f[i] = tolower((unsigned char)h->words[n][i]);
+    }
+}
+
+/*
+ * Append the entries in the given range which match
+ *
+ * Return: 0 on success, or -1 on memory allocation failure
+ */
+
+static int match_range(const struct index *src, size_t from, size_t to,
+                       struct index *dest, const struct match *match)
+{
+    size_t n;
+    struct record *re;
+
+    for (n = from; n < to; n++) {
+        re = src->record[n];
+
+        if (record_match(re, match)) {
+            if (index_reserve(dest, 1) == -1)
+                return -1;
+            index_add(dest, re);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Divide a number of entries into parts, if they are worth sharing
+ * between threads
+ */
+
+static unsigned int divide(size_t entries)
+{
+    size_t parts;
+
+    parts = entries / PARALLEL;
+    if (parts > pool_threads())
+        parts = pool_threads();
+    if (parts == 0)
+        parts = 1;
+
+    return parts;
+}
+
+/*
+ * Return: the first entry in the given part
+ */
+
+static size_t boundary(size_t entries, unsigned int part, unsigned int parts)
+{
+    return entries * part / parts;
+}
+
+struct match_job {
+    const struct index *src;
+    const struct match *match;
+    unsigned int parts;
+    struct index result[POOL_MAX];
+    int status[POOL_MAX];
+};
+
+static void match_part(void *arg, unsigned int part)
+{
+    struct match_job *j = arg;
+
+    trace_begin("match_part");
+    j->status[part] = match_range(j->src,
+                                  boundary(j->src->entries, part, j->parts),
+                                  boundary(j->src->entries, part + 1, j->parts),
+                                  &j->result[part], j->match);
+    trace_end("match_part");
 }
 
 /*
  * Find entries from the source index which match
  *
  * Copy the subset of the source index which matches the given
- * string into the destination.
+ * string into the destination. A large index is divided between
+ * the threads of the pool.
  *
  * Return: 0 on success, or -1 on memory allocation failure
  * Post: on failure, dest is valid but incomplete
@@ -277,22 +490,76 @@ void match_compile(struct match *h, const char *d)
 int index_match(struct index *src, struct index *dest,
                 const struct match *match)
 {
-    int n;
-    struct record *re;
+    int r;
+    unsigned int n;
+    size_t total;
+    struct match_job j;
+
+    trace_begin("index_match");
 
     index_blank(dest);
 
-    for (n = 0; n < src->entries; n++) {
-        re = src->record[n];
+    j.parts = divide(src->entries);
+    if (j.parts == 1) {
+        r = match_range(src, 0, src->entries, dest, match);
+        trace_end("index_match");
+        return r;
+    }
 
-        if (record_match(re, match)) {
-            if (index_reserve(dest, 1) == -1)
-                return -1;
-            index_add(dest, re);
+    /* Match each part of the index in parallel, then join the
+     * results together in order */
+
+    j.src = src;
+    j.match = match;
+
+    for (n = 0; n < j.parts; n++)
+        index_init(&j.result[n]);
+
+    pool_run(match_part, &j, j.parts);
+
+    r = 0;
+    total = 0;
+
+    for (n = 0; n < j.parts; n++) {
+        if (j.status[n] == -1)
+            r = -1;
+        total += j.result[n].entries;
+    }
+
+    if (index_reserve(dest, total) == -1) {
+        r = -1;
+    } else {
+        for (n = 0; n < j.parts; n++) {
+            memcpy(dest->record + dest->entries, j.result[n].record,
+                   sizeof(struct record*) * j.result[n].entries);
+            dest->entries += j.result[n].entries;
         }
     }
 
-    return 0;
+    for (n = 0; n < j.parts; n++)
+        index_clear(&j.result[n]);
+
+    trace_end("index_match");
+
+    return r;
+}
+
+/*
+ * Compare two records in the given sort order
+ */
+
+static int record_cmp(const struct record *a, const struct record *b,
+                      int sort)
+{
+    switch (sort) {
+    case SORT_ARTIST:
+        return record_cmp_artist(a, b);
+    case SORT_BPM:
+        return record_cmp_bpm(a, b);
+    case SORT_PLAYLIST:
+    default:
+        abort();
+    }
 }
 
 /*
@@ -325,17 +592,7 @@ static size_t bin_search(struct record **base, size_t n,
     mid = n / 2;
     x = base[mid];
 
-    switch (sort) {
-    case SORT_ARTIST:
-        r = record_cmp_artist(item, x);
-        break;
-    case SORT_BPM:
-        r = record_cmp_bpm(item, x);
-        break;
-    case SORT_PLAYLIST:
-    default:
-        abort();
-    }
+    r = record_cmp(item, x, sort);
 
     if (r < 0)
         return bin_search(base, mid, item, sort, found);
@@ -348,6 +605,51 @@ static size_t bin_search(struct record **base, size_t n,
     return mid;
 }
 
+/*
+ * Binary search of sorted index, starting from the end
+ *
+ * Probe backwards in exponential steps to bound the search, so the
+ * cost depends on the distance from the end rather than the size of
+ * the index. Suited to merging a batch in descending order.
+ *
+ * Pre: base is sorted
+ * Return: position of match >= item
+ * Post: on exact match, *found is true
+ */
+
+static size_t gallop_search(struct record **base, size_t n,
+                            struct record *item, int sort,
+                            bool *found)
+{
+    size_t step;
+
+    step = 1;
+
+    for (;;) {
+        int r;
+        size_t probe;
+
+        if (step >= n)
+            return bin_search(base, n, item, sort, found);
+
+        probe = n - step;
+        r = record_cmp(item, base[probe], sort);
+
+        if (r > 0) {
+            return probe + 1
+                + bin_search(base + probe + 1, n - probe - 1, item, sort, found);
+        }
+
+        if (r == 0) {
+            *found = true;
+            return probe;
+        }
+
+        n = probe;
+        step *= 2;
+    }
+}
+
 /*
  * Insert or re-use an entry in a sorted index
  *
@@ -377,6 +679,253 @@ struct record* index_insert(struct index *ls, struct record *item,
     return item;
 }
 
+/*
+ * Comparison functions, see qsort(3)
+ */
+
+static int qcompar_artist(const void *a, const void *b)
+{
+    return record_cmp_artist(*(struct record**)a, *(struct record**)b);
+}
+
+static int qcompar_bpm(const void *a, const void *b)
+{
+    return record_cmp_bpm(*(struct record**)a, *(struct record**)b);
+}
+
+static void sort_range(struct record **base, size_t n, int sort)
+{
+    switch (sort) {
+    case SORT_ARTIST:
+        qsort(base, n, sizeof *base, qcompar_artist);
+        break;
+    case SORT_BPM:
+        qsort(base, n, sizeof *base, qcompar_bpm);
+        break;
+    case SORT_PLAYLIST:
+    default:
+        abort();
+    }
+}
+
+struct sort_job {
+    struct record **from, **to;
+    size_t n;
+    int sort;
+    unsigned int parts, width; /* width of runs to merge, in parts */
+};
+
+static void sort_part(void *arg, unsigned int part)
+{
+    struct sort_job *j = arg;
+    size_t a, b;
+
+    a = boundary(j->n, part, j->parts);
+    b = boundary(j->n, part + 1, j->parts);
+
+    sort_range(j->from + a, b - a, j->sort);
+}
+
+/*
+ * Merge a pair of adjacent sorted runs
+ */
+
+static void merge_part(void *arg, unsigned int part)
+{
+    struct sort_job *j = arg;
+    size_t a, b, mid, end, out;
+
+    a = boundary(j->n, 2 * part * j->width, j->parts);
+    mid = boundary(j->n, (2 * part + 1) * j->width, j->parts);
+    end = boundary(j->n, (2 * part + 2) * j->width, j->parts);
+
+    b = mid;
+    out = a;
+
+    while (a < mid && b < end) {
+        if (record_cmp(j->from[b], j->from[a], j->sort) < 0)
+            j->to[out++] = j->from[b++];
+        else
+            j->to[out++] = j->from[a++];
+    }
+
+    memcpy(j->to + out, j->from + a, sizeof(struct record*) * (mid - a));
+    out += mid - a;
+    memcpy(j->to + out, j->from + b, sizeof(struct record*) * (end - b));
+}
+
+/*
+ * Sort an array of records, eg. ready for index_merge()
+ *
+ * A large array is sorted in parts in parallel, and the parts are
+ * then merged in pairs.
+ */
+
+void index_sort(struct record **base, size_t n, int sort)
+{
+    unsigned int parts;
+    struct record **tmp;
+    struct sort_job j;
+
+    /* Merging needs a power of two */
+
+    parts = divide(n);
+    while (parts & (parts - 1))
+        parts &= parts - 1;
+
+    if (parts == 1) {
+        sort_range(base, n, sort);
+        return;
+    }
+
+    tmp = malloc(sizeof *tmp * n);
+    if (tmp == NULL) {
+        sort_range(base, n, sort);
+        return;
+    }
+
+    j.from = base;
+    j.to = tmp;
+    j.n = n;
+    j.sort = sort;
+    j.parts = parts;
+
+    pool_run(sort_part, &j, parts);
+
+    for (j.width = 1; j.width < parts; j.width *= 2) {
+        struct record **x;
+
+        pool_run(merge_part, &j, parts / j.width / 2);
+
+        x = j.from;
+        j.from = j.to;
+        j.to = x;
+    }
+
+    if (j.from != base)
+        memcpy(base, j.from, sizeof *base * n);
+
+    free(tmp);
+}
+
+/*
+ * Remove matching items from a sorted batch, keeping of each run of
+ * matches the one which comes first in the original order
+ *
+ * The sort is not stable, so which of the matching items it leaves
+ * first is arbitrary; this gives the same result as inserting the
+ * batch one item at a time.
+ *
+ * Pre: items are sorted, and are a permutation of order[]
+ * Return: the number of items kept
+ * Post: the items kept are at the start of the array, in order
+ */
+
+size_t index_unique(struct record **item, size_t n,
+                    struct record *const *order, int sort)
+{
+    size_t j, k;
+
+    for (j = 1; j < n; j++) {
+        if (record_cmp(item[j - 1], item[j], sort) == 0)
+            break;
+    }
+
+    if (j >= n)
+        return n; /* the usual case; no duplicates */
+
+    /* Overwrite the head of each run with each member in reverse
+     * order, so the last to be written is the earliest */
+
+    for (k = n; k > 0; k--) {
+        bool found;
+        size_t z;
+
+        z = bin_search(item, n, order[k - 1], sort, &found);
+        assert(found);
+
+        while (z > 0 && record_cmp(item[z - 1], order[k - 1], sort) == 0)
+            z--;
+
+        item[z] = order[k - 1];
+    }
+
+    k = 1;
+    for (j = 1; j < n; j++) {
+        if (record_cmp(item[k - 1], item[j], sort) != 0)
+            item[k++] = item[j];
+    }
+
+    return k;
+}
+
+/*
+ * Merge a sorted batch of items into a sorted index
+ *
+ * Equivalent to index_insert() of each item, but each entry in the
+ * index is moved at most once, instead of once per insertion. The
+ * merge works backwards from the end so it can be done in-place.
+ *
+ * Pre: index is sorted
+ * Pre: items are sorted, but may contain matching items
+ * Pre: at least n entries are reserved
+ * Return: the number of items which were new to the index
+ * Post: index is sorted and contains each item or a matching item
+ * Post: the new items are at the start of the array, in order
+ */
+
+size_t index_merge(struct index *ls, struct record **item, size_t n,
+                   int sort)
+{
+    size_t a, w, t, j;
+    struct record *last;
+
+    assert(ls->entries + n <= ls->size);
+
+    a = ls->entries; /* entries [0, a) are yet to be moved */
+    w = ls->entries + n; /* output is written below here */
+    t = n; /* new items are kept in item[t, n) */
+    last = NULL;
+
+    for (j = n; j > 0; j--) {
+        bool found;
+        size_t z;
+        struct record *x;
+
+        x = item[j - 1];
+
+        if (last != NULL && record_cmp(x, last, sort) == 0)
+            continue;
+
+        /* Move the run of entries ordered after this item */
+
+        z = gallop_search(ls->record, a, x, sort, &found);
+        w -= a - z;
+        memmove(ls->record + w, ls->record + z,
+                sizeof(struct record*) * (a - z));
+        a = z;
+        last = x;
+
+        if (found)
+            continue;
+
+        ls->record[--w] = x;
+        item[--t] = x;
+    }
+
+    /* Close any gap left by items which were already present */
+
+    if (w > a) {
+        memmove(ls->record + a, ls->record + w,
+                sizeof(struct record*) * (ls->entries + n - w));
+    }
+
+    memmove(item, item + t, sizeof(struct record*) * (n - t));
+    ls->entries += n - t;
+
+    return n - t;
+}
+
 /*
  * Reserve space in the index for the addition of n new items
  *
@@ -405,6 +954,39 @@ size_t index_find(struct index *ls, struct record *item, int sort)
     return z;
 }
 
+/*
+ * Return: the entry which matches the item, or NULL if there is none
+ */
+
+struct record* index_lookup(struct index *ls, struct record *item, int sort)
+{
+    bool found;
+    size_t z;
+
+    z = bin_search(ls->record, ls->entries, item, sort, &found);
+    if (!found)
+        return NULL;
+
+    return ls->record[z];
+}
+
+/*
+ * Return: true if the index is strictly in the given order, and so
+ * has no duplicates
+ */
+
+bool index_is_sorted(const struct index *ls, int sort)
+{
+    size_t n;
+
+    for (n = 1; n < ls->entries; n++) {
+        if (record_cmp(ls->record[n - 1], ls->record[n], sort) >= 0)
+            return false;
+    }
+
+    return true;
+}
+
 /*
  * Debug the content of a index to standard error
  */
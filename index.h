@@ -22,6 +22,8 @@
 
 #include <stddef.h>
 
+#include "arena.h"
+
 #define SORT_ARTIST   0
 #define SORT_BPM      1
 #define SORT_PLAYLIST 2
@@ -30,13 +32,19 @@
 /* A single music track in our listings */
 
 struct record {
-    char *pathname, *artist, *title; /* a single malloc */
+    char *pathname, *artist, *title; /* in the arena of the storage */
 
     /* An optional extra string may be used to match against search
      * input; allows us to handle locale but still type in ASCII */
 
     char *match; /* or NULL */
 
+    /* The text which is searched, case-folded in advance and packed
+     * with those of other records */
+
+    const char *key; /* or NULL */
+    size_t keylen;
+
     double bpm; /* or 0.0 if not known */
 };
 
@@ -51,14 +59,16 @@ struct index {
  * matches efficiently */
 
 struct match {
-    char buf[512];
+    char buf[512], folded[512];
     char *words[32]; /* NULL-terminated array */
+    size_t len[32];
 };
 
 void index_init(struct index *ls);
 void index_clear(struct index *ls);
 void index_blank(struct index *ls);
 void index_add(struct index *li, struct record *lr);
+int record_key(struct record *re, struct arena *a);
 bool record_match(struct record *re, const struct match *h);
 int index_copy(const struct index *src, struct index *dest);
 void match_compile(struct match *h, const char *d);
@@ -66,8 +76,15 @@ int index_match(struct index *src, struct index *dest,
                 const struct match *match);
 struct record* index_insert(struct index *ls, struct record *item,
                             int sort);
+void index_sort(struct record **base, size_t n, int sort);
+size_t index_unique(struct record **item, size_t n,
+                    struct record *const *order, int sort);
+size_t index_merge(struct index *ls, struct record **item, size_t n,
+                   int sort);
 int index_reserve(struct index *i, unsigned int n);
 size_t index_find(struct index *ls, struct record *item, int sort);
+struct record* index_lookup(struct index *ls, struct record *item, int sort);
+bool index_is_sorted(const struct index *ls, int sort);
 void index_debug(struct index *ls);
 
 #endif
@@ -24,6 +24,7 @@
 #include <math.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,16 +38,21 @@
 #include "debug.h"
 #include "interface.h"
 #include "layout.h"
+#include "list.h"
 #include "player.h"
 #include "rig.h"
 #include "selector.h"
 #include "status.h"
 #include "timecoder.h"
+#include "trace.h"
 #include "xwax.h"
 
-/* Screen refresh time in milliseconds */
+/* Screen refresh time in milliseconds; the fastest when something is
+ * moving (or the display rate, if slower) and otherwise when idle */
 
 #define REFRESH 10
+#define IDLE_REFRESH 100
+#define IDLE_AFTER 1000 /* ms since anything moved */
 
 /* Font definitions */
 
@@ -115,11 +121,22 @@
 
 #define METER_WARNING_TIME 20 /* time in seconds for "red waveform" warning */
 
+/* Cache of rendered text */
+
+#define TEXT_CACHE 512 /* strings */
+#define TEXT_BUCKETS 1024 /* power of two */
+
 /* Function key (F1-F12) definitions */
 
 #define FUNC_LOAD 0
 #define FUNC_RECUE 1
 #define FUNC_TIMECODE 2
+#define FUNC_TELEMETRY 3
+
+/* Timecode signal quality, on request and in the log */
+
+#define TELEMETRY_UPDATE 500 /* ms between updates to the display */
+#define TELEMETRY_LOG 60000 /* ms between lines in the log */
 
 /* Types of SDL_USEREVENT */
 
@@ -172,6 +189,126 @@ static SDL_Color background_col = {0, 0, 0, 255},
 
 static unsigned short *spinner_angle, spinner_size;
 
+/* Text which has been rendered, kept in case it is drawn again */
+
+static struct text {
+    struct list lru;
+    struct text *next; /* in the same bucket */
+    unsigned int hash;
+
+    TTF_Font *font;
+    SDL_Color fg, bg;
+    bool locale;
+    char *string; /* or NULL if not in use */
+
+    SDL_Surface *rendered;
+} text[TEXT_CACHE], *text_bucket[TEXT_BUCKETS];
+
+static struct list text_lru;
+
+/* Performance of the interface, logged periodically */
+
+static struct {
+    Uint32 logged;
+    unsigned long frames, text_hits, text_misses,
+        missed; /* ticks dropped as the previous one was not handled */
+    Uint64 drawing, /* in units of SDL_GetPerformanceFrequency() */
+        deck[MAX_DECKS],
+        library, status, decks, meters, scope, spinner, text;
+} stats;
+
+/*
+ * Add the time since the given start to a counter in the stats
+ */
+
+static void account(Uint64 *counter, Uint64 start)
+{
+    *counter += SDL_GetPerformanceCounter() - start;
+}
+
+/*
+ * Start counting afresh the time spent drawing
+ */
+
+static void reset_stats(void)
+{
+    size_t d;
+
+    stats.frames = 0;
+    stats.drawing = 0;
+    stats.text_hits = 0;
+    stats.text_misses = 0;
+
+    for (d = 0; d < ndeck; d++)
+        stats.deck[d] = 0;
+
+    stats.library = 0;
+    stats.status = 0;
+    stats.decks = 0;
+    stats.meters = 0;
+    stats.scope = 0;
+    stats.spinner = 0;
+    stats.text = 0;
+}
+
+static struct telemetry {
+    bool show;
+    Uint32 updated, logged;
+    struct timecoder_stats since_update, since_log;
+    struct timecoder_quality quality;
+} telemetry[MAX_DECKS];
+
+/* The columns of a meter as they were last drawn, so that only the
+ * columns which change need to be drawn again */
+
+struct column {
+    int height, fade; /* or height of -1 if not drawn */
+    SDL_Color col;
+};
+
+struct meter {
+    SDL_Surface *surface; /* or NULL if nothing is drawn */
+    struct rect rect;
+    int scale, origin; /* close-up only; position of the first column */
+    struct column *column;
+};
+
+static struct waveform {
+    struct meter overview, closeup;
+} waveform[MAX_DECKS];
+
+/* What is to be drawn; copied from the rig with the lock held, so
+ * that the drawing itself can be done without the lock */
+
+struct scene_crate {
+    const char *name;
+    bool is_fixed, is_busy;
+};
+
+static struct scene {
+    unsigned int redraw;
+    struct rect whole, players, library, status;
+
+    int status_level;
+    char message[256];
+
+    int sort;
+    char search[256];
+    size_t matches;
+    struct listbox crates, records;
+    size_t rows; /* allocated for each of the below */
+    struct scene_crate *crate; /* visible rows only */
+    struct record **record; /* visible rows only */
+
+    struct track *track[MAX_DECKS]; /* reference is held */
+    const struct record *loaded[MAX_DECKS];
+} scene;
+
+/* Pacing of the refresh, which the timer reads */
+
+static volatile Uint32 refresh = REFRESH;
+static Uint32 active_refresh = REFRESH, moved;
+
 static int meter_scale = DEFAULT_METER_SCALE;
 static float scale = DEFAULT_SCALE;
 static iconv_t utf;
@@ -396,11 +533,161 @@ static Uint32 palette(SDL_Surface *sf, SDL_Color *col)
     return SDL_MapRGB(sf->format, col->r, col->g, col->b);
 }
 
+static void init_text_cache(void)
+{
+    size_t n;
+
+    list_init(&text_lru);
+
+    for (n = 0; n < TEXT_CACHE; n++) {
+        text[n].string = NULL;
+        text[n].rendered = NULL;
+        list_add_tail(&text[n].lru, &text_lru);
+    }
+}
+
+static void forget_text(struct text *t)
+{
+    struct text **p;
+
+    if (t->string == NULL)
+        return;
+
+    for (p = &text_bucket[t->hash % TEXT_BUCKETS]; *p != t; p = &(*p)->next)
+        assert(*p != NULL);
+    *p = t->next;
+
+    if (t->rendered != NULL)
+        SDL_FreeSurface(t->rendered);
+    free(t->string);
+    t->string = NULL;
+}
+
+static void clear_text_cache(void)
+{
+    size_t n;
+
+    for (n = 0; n < TEXT_CACHE; n++)
+        forget_text(&text[n]);
+}
+
+static unsigned int hash_text(const char *buf, TTF_Font *font,
+                              SDL_Color fg, SDL_Color bg, bool locale)
+{
+    unsigned int h;
+
+    h = 2166136261u; /* FNV-1a */
+
+    for (; *buf != '\0'; buf++)
+        h = (h ^ (unsigned char)*buf) * 16777619u;
+
+    h = (h ^ (uintptr_t)font) * 16777619u;
+    h = (h ^ (fg.r << 16 | fg.g << 8 | fg.b)) * 16777619u;
+    h = (h ^ (bg.r << 16 | bg.g << 8 | bg.b)) * 16777619u;
+    h = (h ^ locale) * 16777619u;
+
+    return h;
+}
+
+static bool same_color(SDL_Color a, SDL_Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+/*
+ * Render text, without the cache
+ *
+ * Return: new surface, or NULL on error
+ */
+
+static SDL_Surface* render_text(const char *buf, TTF_Font *font,
+                                SDL_Color fg, SDL_Color bg, bool locale)
+{
+    char ubuf[256], /* fixed buffer is reasonable for rendering */
+        *in, *out;
+    size_t len, fill;
+
+    if (!locale)
+        return TTF_RenderText_Shaded(font, buf, fg, bg);
+
+    out = ubuf;
+    fill = sizeof(ubuf) - 1; /* always leave space for \0 */
+
+    if (iconv(utf, NULL, NULL, &out, &fill) == -1)
+        abort();
+
+    in = strdupa(buf);
+    len = strlen(in);
+
+    (void)iconv(utf, &in, &len, &out, &fill);
+    *out = '\0';
+
+    return TTF_RenderUTF8_Shaded(font, ubuf, fg, bg);
+}
+
+/*
+ * Get the rendering of some text; from the cache if it has been
+ * rendered recently, in which case it is only a lookup
+ *
+ * Return: surface owned by the cache, or NULL on error
+ */
+
+static SDL_Surface* get_text(const char *buf, TTF_Font *font,
+                             SDL_Color fg, SDL_Color bg, bool locale)
+{
+    unsigned int h;
+    struct text *t, **b;
+
+    h = hash_text(buf, font, fg, bg, locale);
+    b = &text_bucket[h % TEXT_BUCKETS];
+
+    for (t = *b; t != NULL; t = t->next) {
+        if (t->hash == h && t->font == font && t->locale == locale
+            && same_color(t->fg, fg) && same_color(t->bg, bg)
+            && strcmp(t->string, buf) == 0)
+        {
+            stats.text_hits++;
+            list_del(&t->lru);
+            list_add(&t->lru, &text_lru);
+            return t->rendered;
+        }
+    }
+
+    stats.text_misses++;
+
+    /* Replace the least recently used */
+
+    t = list_entry(text_lru.prev, struct text, lru);
+    forget_text(t);
+
+    t->string = strdup(buf);
+    if (t->string == NULL) {
+        perror("strdup");
+        return NULL;
+    }
+
+    t->rendered = render_text(buf, font, fg, bg, locale);
+    t->hash = h;
+    t->font = font;
+    t->fg = fg;
+    t->bg = bg;
+    t->locale = locale;
+
+    t->next = *b;
+    *b = t;
+
+    list_del(&t->lru);
+    list_add(&t->lru, &text_lru);
+
+    return t->rendered;
+}
+
 /*
  * Draw text
  *
  * Render the string "buf" text inside the given "rect".  If "locale"
- * is set then a conversion from the system locale is done.
+ * is set then a conversion from the system locale is done. Most text
+ * is the same from one frame to the next, so comes from the cache.
  *
  * Return: width of text drawn
  */
@@ -411,6 +698,9 @@ static int do_draw_text(SDL_Surface *sf, const struct rect *rect,
 {
     SDL_Surface *rendered;
     SDL_Rect dst, src, fill;
+    Uint64 start;
+
+    start = SDL_GetPerformanceCounter();
 
     if (buf == NULL) {
         src.w = 0;
@@ -420,29 +710,11 @@ static int do_draw_text(SDL_Surface *sf, const struct rect *rect,
         src.w = 0;
         src.h = 0;
 
-    } else {
-        if (!locale) {
-            rendered = TTF_RenderText_Shaded(font, buf, fg, bg);
-        } else {
-            char ubuf[256], /* fixed buffer is reasonable for rendering */
-                *in, *out;
-            size_t len, fill;
-
-            out = ubuf;
-            fill = sizeof(ubuf) - 1; /* always leave space for \0 */
-
-            if (iconv(utf, NULL, NULL, &out, &fill) == -1)
-                abort();
-
-            in = strdupa(buf);
-            len = strlen(in);
-
-            (void)iconv(utf, &in, &len, &out, &fill);
-            *out = '\0';
-
-            rendered = TTF_RenderUTF8_Shaded(font, ubuf, fg, bg);
-        }
+    } else if ((rendered = get_text(buf, font, fg, bg, locale)) == NULL) {
+        src.w = 0;
+        src.h = 0;
 
+    } else {
         src.x = 0;
         src.y = 0;
         src.w = MIN(rect->w, rendered->w);
@@ -452,7 +724,6 @@ static int do_draw_text(SDL_Surface *sf, const struct rect *rect,
         dst.y = rect->y;
 
         SDL_BlitSurface(rendered, &src, sf, &dst);
-        SDL_FreeSurface(rendered);
     }
 
     /* Complete the remaining space with a blank rectangle */
@@ -473,6 +744,8 @@ static int do_draw_text(SDL_Surface *sf, const struct rect *rect,
         SDL_FillRect(sf, &fill, palette(sf, &bg));
     }
 
+    account(&stats.text, start);
+
     return src.w;
 }
 
@@ -699,6 +972,108 @@ static void draw_clock(SDL_Surface *surface, const struct rect *rect, int t,
     draw_text(surface, &sr, deci, deci_font, col, background_col);
 }
 
+/*
+ * Primitives which set pixels of the framebuffer directly, for the
+ * widgets which are drawn a pixel at a time
+ *
+ * Pixels are blue, green then red in memory. Where there are four
+ * bytes per pixel (the usual XRGB8888) a pixel is written whole, in
+ * loops simple enough for the compiler to vectorise; otherwise a
+ * byte at a time.
+ */
+
+static Uint32 xrgb(Uint8 r, Uint8 g, Uint8 b)
+{
+    Uint8 x[4] = { b, g, r, 0 };
+    Uint32 v;
+
+    memcpy(&v, x, sizeof v);
+    return v;
+}
+
+static void put_pixel(Uint8 *p, Uint8 r, Uint8 g, Uint8 b)
+{
+    p[0] = b;
+    p[1] = g;
+    p[2] = r;
+}
+
+/*
+ * Fill n pixels of a column in a single colour, downwards from p
+ */
+
+static void fill_column(Uint8 *p, int bytes_per_pixel, int pitch, int n,
+                        SDL_Color col)
+{
+    if (bytes_per_pixel == 4) {
+        Uint32 v = xrgb(col.r, col.g, col.b);
+
+        while (n-- > 0) {
+            *(Uint32*)p = v;
+            p += pitch;
+        }
+    } else {
+        while (n-- > 0) {
+            put_pixel(p, col.r, col.g, col.b);
+            p += pitch;
+        }
+    }
+}
+
+/*
+ * Set a row of n pixels to the given grey levels, but no darker than
+ * the floor
+ */
+
+static void grey_row(Uint8 *p, int bytes_per_pixel,
+                     const unsigned char *level, int n, unsigned char floor)
+{
+    int c;
+
+    if (bytes_per_pixel == 4) {
+        Uint32 *x = (Uint32*)p, unit = xrgb(1, 1, 1);
+
+        for (c = 0; c < n; c++) {
+            Uint32 v = level[c] > floor ? level[c] : floor;
+            x[c] = v * unit;
+        }
+    } else {
+        for (c = 0; c < n; c++) {
+            Uint8 v = level[c] > floor ? level[c] : floor;
+            put_pixel(p + c * bytes_per_pixel, v, v, v);
+        }
+    }
+}
+
+/*
+ * Set a row of n pixels of the spinner from their angles (0 to 1023);
+ * the half of the circle behind 'rangle' is dimmed
+ */
+
+static void spinner_row(Uint8 *p, int bytes_per_pixel,
+                        const unsigned short *angle, int n, int rangle,
+                        SDL_Color col)
+{
+    int c;
+    SDL_Color dark;
+
+    dark = dim(col, 2);
+
+    if (bytes_per_pixel == 4) {
+        Uint32 *x = (Uint32*)p,
+            on = xrgb(col.r, col.g, col.b),
+            off = xrgb(dark.r, dark.g, dark.b);
+
+        for (c = 0; c < n; c++)
+            x[c] = (rangle - angle[c]) & 512 ? on : off;
+    } else {
+        for (c = 0; c < n; c++) {
+            SDL_Color v = (rangle - angle[c]) & 512 ? col : dark;
+            put_pixel(p + c * bytes_per_pixel, v.r, v.g, v.b);
+        }
+    }
+}
+
 /*
  * Draw the visual monitor of the input audio to the timecoder
  */
@@ -706,8 +1081,9 @@ static void draw_clock(SDL_Surface *surface, const struct rect *rect, int t,
 static void draw_scope(SDL_Surface *surface, const struct rect *rect,
                        struct timecoder *tc)
 {
-    int r, c, v;
+    int r, bytes_per_pixel;
     unsigned short size, mid;
+    const unsigned char *row;
     Uint8 *p;
 
     assert(rect->w == tc->scope_size);
@@ -716,21 +1092,20 @@ static void draw_scope(SDL_Surface *surface, const struct rect *rect,
 
     mid = size / 2;
 
-    for (r = 0; r < size; r++) {
-        for (c = 0; c < size; c++) {
-            p = surface->pixels
-                + (rect->y + r) * surface->pitch
-                + (rect->x + c) * surface->format->BytesPerPixel;
+    bytes_per_pixel = surface->format->BytesPerPixel;
+    p = (Uint8*)surface->pixels + rect->y * surface->pitch
+        + rect->x * bytes_per_pixel;
+
+    /* The axes are drawn as a floor to the level */
 
-            v = tc->scope[r * size + c];
+    for (r = 0; r < size; r++) {
+        row = tc->scope + r * size;
 
-            if ((r == mid || c == mid) && v < 64)
-                v = 64;
+        grey_row(p, bytes_per_pixel, row, size, r == mid ? 64 : 0);
+        grey_row(p + mid * bytes_per_pixel, bytes_per_pixel,
+                 row + mid, 1, 64);
 
-            p[0] = v;
-            p[1] = p[0];
-            p[2] = p[1];
-        }
+        p += surface->pitch;
     }
 }
 
@@ -744,14 +1119,11 @@ static void draw_scope(SDL_Surface *surface, const struct rect *rect,
 static void draw_spinner(SDL_Surface *surface, const struct rect *rect,
                          struct player *pl)
 {
-    int x, y, r, c, rangle, pangle;
+    int r, rangle, bytes_per_pixel;
     double elapsed, remain, rps;
-    Uint8 *rp, *p;
+    Uint8 *p;
     SDL_Color col;
 
-    x = rect->x;
-    y = rect->y;
-
     elapsed = player_get_elapsed(pl);
     remain = player_get_remain(pl);
 
@@ -763,33 +1135,16 @@ static void draw_spinner(SDL_Surface *surface, const struct rect *rect,
     else
         col = ok_col;
 
-    for (r = 0; r < spinner_size; r++) {
-
-        /* Store a pointer to this row of the framebuffer */
-
-        rp = surface->pixels + (y + r) * surface->pitch;
-
-        for (c = 0; c < spinner_size; c++) {
-
-            /* Use the lookup table to provide the angle at each
-             * pixel */
-
-            pangle = spinner_angle[r * spinner_size + c];
-
-            /* Calculate the final pixel location and set it */
+    bytes_per_pixel = surface->format->BytesPerPixel;
+    p = (Uint8*)surface->pixels + rect->y * surface->pitch
+        + rect->x * bytes_per_pixel;
 
-            p = rp + (x + c) * surface->format->BytesPerPixel;
+    /* Use the lookup table to provide the angle at each pixel */
 
-            if ((rangle - pangle + 1024) % 1024 < 512) {
-                p[0] = col.b >> 2;
-                p[1] = col.g >> 2;
-                p[2] = col.r >> 2;
-            } else {
-                p[0] = col.b;
-                p[1] = col.g;
-                p[2] = col.r;
-            }
-        }
+    for (r = 0; r < spinner_size; r++) {
+        spinner_row(p, bytes_per_pixel, spinner_angle + r * spinner_size,
+                    spinner_size, rangle, col);
+        p += surface->pitch;
     }
 }
 
@@ -830,26 +1185,167 @@ static void draw_deck_clocks(SDL_Surface *surface, const struct rect *rect,
 }
 
 /*
- * Draw the high-level overview meter which shows the whole length
- * of the track
+ * Forget what has been drawn of a meter, so that it is drawn in full
+ * next time
+ */
+
+static void forget_meter(struct meter *m)
+{
+    free(m->column);
+    m->column = NULL;
+    m->surface = NULL;
+}
+
+static void forget_meters(void)
+{
+    size_t d;
+
+    for (d = 0; d < MAX_DECKS; d++) {
+        forget_meter(&waveform[d].overview);
+        forget_meter(&waveform[d].closeup);
+    }
+}
+
+/*
+ * Prepare to draw a meter in the given area; anything previously
+ * drawn elsewhere is forgotten
+ *
+ * If there is no memory for the columns then the meter is drawn in
+ * full, as if there was no record of it.
+ */
+
+static void place_meter(struct meter *m, SDL_Surface *surface,
+                        const struct rect *rect)
+{
+    int c;
+
+    if (m->surface == surface
+        && m->rect.x == rect->x && m->rect.y == rect->y
+        && m->rect.w == rect->w && m->rect.h == rect->h)
+    {
+        return;
+    }
+
+    forget_meter(m);
+
+    m->column = malloc(sizeof *m->column * rect->w);
+    if (m->column == NULL) {
+        perror("malloc");
+        return;
+    }
+
+    for (c = 0; c < rect->w; c++)
+        m->column[c].height = -1;
+
+    m->surface = surface;
+    m->rect = *rect;
+}
+
+/*
+ * Move what is drawn of a meter by the given number of columns to the
+ * left (or right, if negative), so only the exposed columns need to
+ * be drawn
+ */
+
+static void scroll_meter(struct meter *m, int k)
+{
+    int r, c, w, bytes_per_pixel, pitch;
+    Uint8 *p;
+
+    w = m->rect.w;
+
+    if (m->column == NULL || k == 0)
+        return;
+
+    if (abs(k) >= w) {
+        for (c = 0; c < w; c++)
+            m->column[c].height = -1;
+        return;
+    }
+
+    bytes_per_pixel = m->surface->format->BytesPerPixel;
+    pitch = m->surface->pitch;
+    p = (Uint8*)m->surface->pixels + m->rect.y * pitch
+        + m->rect.x * bytes_per_pixel;
+
+    for (r = 0; r < m->rect.h; r++) {
+        if (k > 0)
+            memmove(p, p + k * bytes_per_pixel, (w - k) * bytes_per_pixel);
+        else
+            memmove(p - k * bytes_per_pixel, p, (w + k) * bytes_per_pixel);
+        p += pitch;
+    }
+
+    if (k > 0) {
+        memmove(m->column, m->column + k, sizeof *m->column * (w - k));
+        for (c = w - k; c < w; c++)
+            m->column[c].height = -1;
+    } else {
+        memmove(m->column - k, m->column, sizeof *m->column * (w + k));
+        for (c = 0; c < -k; c++)
+            m->column[c].height = -1;
+    }
+}
+
+/*
+ * Draw a column of a meter, unless it is already drawn; a meter
+ * of the given height in pixels, and the remainder faded
+ */
+
+static void draw_column(struct meter *m, SDL_Surface *surface,
+                        const struct rect *rect, int c,
+                        int height, SDL_Color col, int fade)
+{
+    int faded, bytes_per_pixel, pitch;
+    Uint8 *p;
+
+    if (m->column != NULL) {
+        struct column *x = &m->column[c];
+
+        if (x->height == height && x->fade == fade
+            && same_color(x->col, col))
+        {
+            return;
+        }
+
+        x->height = height;
+        x->fade = fade;
+        x->col = col;
+    }
+
+    bytes_per_pixel = surface->format->BytesPerPixel;
+    pitch = surface->pitch;
+
+    /* From the top of the column; the part above the meter is
+     * faded */
+
+    p = (Uint8*)surface->pixels + rect->y * pitch
+        + (rect->x + c) * bytes_per_pixel;
+
+    faded = rect->h - height;
+    if (faded < 0)
+        faded = 0;
+
+    fill_column(p, bytes_per_pixel, pitch, faded, dim(col, fade));
+    fill_column(p + faded * pitch, bytes_per_pixel, pitch,
+                rect->h - faded, col);
+}
+
+/*
+ * Draw the track overview meter; only the columns which have changed
+ * since it was last drawn, eg. the needle or the data being imported
  */
 
 static void draw_overview(SDL_Surface *surface, const struct rect *rect,
-                          struct track *tr, int position)
+                          struct meter *m, struct track *tr, int position)
 {
-    int x, y, w, h, r, c, sp, fade, bytes_per_pixel, pitch, height,
-        current_position;
-    Uint8 *pixels, *p;
+    int w, h, c, sp, fade, height, current_position;
     SDL_Color col;
 
-    x = rect->x;
-    y = rect->y;
     w = rect->w;
     h = rect->h;
 
-    pixels = surface->pixels;
-    bytes_per_pixel = surface->format->BytesPerPixel;
-    pitch = surface->pitch;
+    place_meter(m, surface, rect);
 
     if (tr->length)
         current_position = (long long)position * w / tr->length;
@@ -889,64 +1385,55 @@ static void draw_overview(SDL_Surface *surface, const struct rect *rect,
         if (c < current_position)
             col = dim(col, 1);
 
-        /* Store a pointer to this column of the framebuffer */
-
-        p = pixels + y * pitch + (x + c) * bytes_per_pixel;
-
-        r = h;
-        while (r > height) {
-            p[0] = col.b >> fade;
-            p[1] = col.g >> fade;
-            p[2] = col.r >> fade;
-            p += pitch;
-            r--;
-        }
-        while (r) {
-            p[0] = col.b;
-            p[1] = col.g;
-            p[2] = col.r;
-            p += pitch;
-            r--;
-        }
+        draw_column(m, surface, rect, c, height, col, fade);
     }
 }
 
 /*
  * Draw the close-up meter, which can be zoomed to a level set by
- * 'scale'
+ * 'scale'; each column is the peak of the meter over the samples
+ * it covers
+ *
+ * As the track plays, what was drawn before is scrolled along and
+ * only the columns which are exposed are drawn.
  */
 
 static void draw_closeup(SDL_Surface *surface, const struct rect *rect,
-                         struct track *tr, int position, int scale)
+                         struct meter *m, struct track *tr, int position,
+                         int scale)
 {
-    int x, y, w, h, c;
-    size_t bytes_per_pixel, pitch;
-    Uint8 *pixels;
+    int w, h, c, origin;
 
-    x = rect->x;
-    y = rect->y;
     w = rect->w;
     h = rect->h;
 
-    pixels = surface->pixels;
-    bytes_per_pixel = surface->format->BytesPerPixel;
-    pitch = surface->pitch;
+    place_meter(m, surface, rect);
+
+    /* The position of the first column, which is aligned so that
+     * each column is always the same part of the track */
+
+    origin = position - (position % (1 << scale)) - ((w / 2) << scale);
+
+    if (m->column != NULL) {
+        if (m->scale == scale)
+            scroll_meter(m, (origin - m->origin) >> scale);
+        else
+            scroll_meter(m, w);
 
-    /* Draw in columns. This may seem like a performance hit,
-     * but oprofile shows it makes no difference */
+        m->scale = scale;
+        m->origin = origin;
+    }
 
     for (c = 0; c < w; c++) {
-        int r, sp, height, fade;
-        Uint8 *p;
+        int sp, height, fade;
         SDL_Color col;
 
         /* Work out the meter height in pixels for this column */
 
-        sp = position - (position % (1 << scale))
-            + ((c - w / 2) << scale);
+        sp = origin + (c << scale);
 
         if (sp < tr->length && sp > 0)
-            height = track_get_ppm(tr, sp) * h / 256;
+            height = track_get_peak(tr, sp, scale) * h / 256;
         else
             height = 0;
 
@@ -960,26 +1447,7 @@ static void draw_closeup(SDL_Surface *surface, const struct rect *rect,
             fade = 3;
         }
 
-        /* Get a pointer to the top of the column, and increment
-         * it for each row */
-
-        p = pixels + y * pitch + (x + c) * bytes_per_pixel;
-
-        r = h;
-        while (r > height) {
-            p[0] = col.b >> fade;
-            p[1] = col.g >> fade;
-            p[2] = col.r >> fade;
-            p += pitch;
-            r--;
-        }
-        while (r) {
-            p[0] = col.b;
-            p[1] = col.g;
-            p[2] = col.r;
-            p += pitch;
-            r--;
-        }
+        draw_column(m, surface, rect, c, height, col, fade);
     }
 }
 
@@ -988,18 +1456,19 @@ static void draw_closeup(SDL_Surface *surface, const struct rect *rect,
  */
 
 static void draw_meters(SDL_Surface *surface, const struct rect *rect,
-                        struct track *tr, int position, int scale)
+                        struct waveform *wf, struct track *tr,
+                        int position, int scale)
 {
     struct rect overview, closeup;
 
     split(*rect, from_top(OVERVIEW_HEIGHT, SPACER), &overview, &closeup);
 
     if (closeup.h > OVERVIEW_HEIGHT)
-        draw_overview(surface, &overview, tr, position);
+        draw_overview(surface, &overview, &wf->overview, tr, position);
     else
         closeup = *rect;
 
-    draw_closeup(surface, &closeup, tr, position, scale);
+    draw_closeup(surface, &closeup, &wf->closeup, tr, position, scale);
 }
 
 /*
@@ -1010,6 +1479,7 @@ static void draw_deck_top(SDL_Surface *surface, const struct rect *rect,
                           struct player *pl, struct track *track)
 {
     struct rect clocks, left, right, spinner, scope;
+    Uint64 start;
 
     split(*rect, from_left(CLOCKS_WIDTH, SPACER), &clocks, &right);
 
@@ -1027,13 +1497,29 @@ static void draw_deck_top(SDL_Surface *surface, const struct rect *rect,
     if (left.w < 0)
         return;
     split(spinner, from_bottom(SPINNER_SIZE, 0), NULL, &spinner);
+    start = SDL_GetPerformanceCounter();
     draw_spinner(surface, &spinner, pl);
+    account(&stats.spinner, start);
 
     split(left, from_right(SCOPE_SIZE, SPACER), &clocks, &scope);
     if (clocks.w < 0)
         return;
     split(scope, from_bottom(SCOPE_SIZE, 0), NULL, &scope);
+    start = SDL_GetPerformanceCounter();
     draw_scope(surface, &scope, pl->timecoder);
+    account(&stats.scope, start);
+}
+
+/*
+ * Describe the quality of the timecode signal
+ */
+
+static void format_quality(char *buf, const struct timecoder_quality *q)
+{
+    sprintf(buf, "err:%5.1f%% lvl:%3.0f%% dc:%4.1f%% "
+            "lock:%3.0f%% rev:%4.1f/s last:%5.1fs",
+            q->error_rate * 100, q->level * 100, q->offset * 100,
+            q->lock * 100, q->reversals, q->since_valid);
 }
 
 /*
@@ -1043,7 +1529,8 @@ static void draw_deck_top(SDL_Surface *surface, const struct rect *rect,
 
 static void draw_deck_status(SDL_Surface *surface,
                              const struct rect *rect,
-                             const struct deck *deck)
+                             const struct deck *deck,
+                             const struct telemetry *telemetry)
 {
     char buf[128], *c;
     int tc;
@@ -1053,6 +1540,12 @@ static void draw_deck_status(SDL_Surface *surface,
 
     c += sprintf(c, "%s: ", pl->timecoder->def->name);
 
+    if (telemetry->show) {
+        format_quality(c, &telemetry->quality);
+        draw_text(surface, rect, buf, detail_font, detail_col, background_col);
+        return;
+    }
+
     tc = timecoder_get_position(pl->timecoder, NULL);
     if (pl->timecode_control && tc != -1) {
         c += sprintf(c, "%7d ", tc);
@@ -1076,15 +1569,16 @@ static void draw_deck_status(SDL_Surface *surface,
  */
 
 static void draw_deck(SDL_Surface *surface, const struct rect *rect,
-                      struct deck *deck, int meter_scale)
+                      struct deck *deck, const struct telemetry *telemetry,
+                      struct waveform *waveform, struct track *t,
+                      const struct record *record, int meter_scale)
 {
     int position;
     struct rect track, top, meters, status, rest, lower;
+    Uint64 start;
     struct player *pl;
-    struct track *t;
 
     pl = &deck->player;
-    t = pl->track;
 
     position = player_get_elapsed(pl) * t->rate;
 
@@ -1092,7 +1586,7 @@ static void draw_deck(SDL_Surface *surface, const struct rect *rect,
     if (rest.h < 160)
         rest = *rect;
     else
-        draw_record(surface, &track, deck->record);
+        draw_record(surface, &track, record);
 
     split(rest, from_top(CLOCK_FONT_SIZE * 2, SPACER), &top, &lower);
     if (lower.h < 64)
@@ -1104,9 +1598,11 @@ static void draw_deck(SDL_Surface *surface, const struct rect *rect,
     if (meters.h < 64)
         meters = lower;
     else
-        draw_deck_status(surface, &status, deck);
+        draw_deck_status(surface, &status, deck, telemetry);
 
-    draw_meters(surface, &meters, t, position, meter_scale);
+    start = SDL_GetPerformanceCounter();
+    draw_meters(surface, &meters, waveform, t, position, meter_scale);
+    account(&stats.meters, start);
 }
 
 /*
@@ -1114,7 +1610,8 @@ static void draw_deck(SDL_Surface *surface, const struct rect *rect,
  */
 
 static void draw_decks(SDL_Surface *surface, const struct rect *rect,
-                       struct deck deck[], size_t ndecks, int meter_scale)
+                       const struct scene *sc, struct deck deck[],
+                       size_t ndecks, int meter_scale)
 {
     int d;
     struct rect left, right;
@@ -1122,8 +1619,15 @@ static void draw_decks(SDL_Surface *surface, const struct rect *rect,
     right = *rect;
 
     for (d = 0; d < ndecks; d++) {
+        Uint64 start;
+
+        start = SDL_GetPerformanceCounter();
+
         split(right, columns(d, ndecks, BORDER), &left, &right);
-        draw_deck(surface, &left, &deck[d], meter_scale);
+        draw_deck(surface, &left, &deck[d], &telemetry[d], &waveform[d],
+                  sc->track[d], sc->loaded[d], meter_scale);
+
+        account(&stats.deck[d], start);
     }
 }
 
@@ -1131,11 +1635,12 @@ static void draw_decks(SDL_Surface *surface, const struct rect *rect,
  * Draw the status bar
  */
 
-static void draw_status(SDL_Surface *sf, const struct rect *rect)
+static void draw_status(SDL_Surface *sf, const struct rect *rect,
+                        const struct scene *sc)
 {
     SDL_Color fg, bg;
 
-    switch (status_level()) {
+    switch (sc->status_level) {
     case STATUS_ALERT:
     case STATUS_WARN:
         fg = text_col;
@@ -1146,7 +1651,7 @@ static void draw_status(SDL_Surface *sf, const struct rect *rect)
         bg = background_col;
     }
 
-    draw_text_in_locale(sf, rect, status(), detail_font, fg, bg);
+    draw_text_in_locale(sf, rect, sc->message, detail_font, fg, bg);
 }
 
 /*
@@ -1154,7 +1659,7 @@ static void draw_status(SDL_Surface *sf, const struct rect *rect)
  */
 
 static void draw_search(SDL_Surface *surface, const struct rect *rect,
-                        struct selector *sel)
+                        const struct scene *sc)
 {
     int s;
     const char *buf;
@@ -1164,8 +1669,8 @@ static void draw_search(SDL_Surface *surface, const struct rect *rect,
 
     split(*rect, from_left(SCROLLBAR_SIZE, SPACER), NULL, &rtext);
 
-    if (sel->search[0] != '\0')
-        buf = sel->search;
+    if (sc->search[0] != '\0')
+        buf = sc->search;
     else
         buf = NULL;
 
@@ -1178,9 +1683,9 @@ static void draw_search(SDL_Surface *surface, const struct rect *rect,
 
     SDL_FillRect(surface, &cursor, palette(surface, &cursor_col));
 
-    if (sel->view_index->entries > 1)
-        sprintf(cm, "%zd matches", sel->view_index->entries);
-    else if (sel->view_index->entries > 0)
+    if (sc->matches > 1)
+        sprintf(cm, "%zd matches", sc->matches);
+    else if (sc->matches > 0)
         sprintf(cm, "1 match");
     else
         sprintf(cm, "no matches");
@@ -1269,12 +1774,12 @@ static void draw_crate_row(const void *context,
                            SDL_Surface *surface, const struct rect rect,
                            unsigned int entry, bool selected)
 {
-    const struct selector *selector = context;
-    const struct crate *crate;
+    const struct scene *sc = context;
+    const struct scene_crate *crate;
     struct rect left, right;
     SDL_Color col;
 
-    crate = selector->library->crate[entry];
+    crate = &sc->crate[entry - sc->crates.offset];
 
     if (crate->is_fixed)
         col = detail_col;
@@ -1289,7 +1794,7 @@ static void draw_crate_row(const void *context,
 
     split(rect, from_right(SORT_WIDTH, 0), &left, &right);
 
-    switch (selector->sort) {
+    switch (sc->sort) {
     case SORT_ARTIST:
         draw_token(surface, &right, "ART", text_col, artist_col, selected_col);
         break;
@@ -1320,9 +1825,9 @@ static void draw_crate_row(const void *context,
  */
 
 static void draw_crates(SDL_Surface *surface, const struct rect rect,
-                        const struct selector *x)
+                        const struct scene *sc)
 {
-    draw_listbox(&x->crates, surface, rect, x, draw_crate_row);
+    draw_listbox(&sc->crates, surface, rect, sc, draw_crate_row);
 }
 
 static void draw_record_row(const void *context,
@@ -1331,7 +1836,7 @@ static void draw_record_row(const void *context,
 {
     int width;
     struct record *record;
-    const struct index *index = context;
+    const struct scene *sc = context;
     struct rect left, right;
     SDL_Color col;
 
@@ -1344,7 +1849,7 @@ static void draw_record_row(const void *context,
     if (width > RESULTS_ARTIST_WIDTH)
         width = RESULTS_ARTIST_WIDTH;
 
-    record = index->record[entry];
+    record = sc->record[entry - sc->records.offset];
 
     split(rect, from_left(BPM_WIDTH, 0), &left, &right);
     draw_bpm_field(surface, &left, record->bpm, col);
@@ -1366,9 +1871,22 @@ static void draw_record_row(const void *context,
  */
 
 static void draw_index(SDL_Surface *surface, const struct rect rect,
-                         const struct selector *x)
+                       const struct scene *sc)
+{
+    draw_listbox(&sc->records, surface, rect, sc, draw_record_row);
+}
+
+/*
+ * The number of rows of the music library which fit in the given
+ * area, or zero if only the search is shown
+ */
+
+static unsigned int library_rows(const struct rect *rect)
 {
-    draw_listbox(&x->records, surface, rect, x->view_index, draw_record_row);
+    struct rect rsearch, rlists;
+
+    split(*rect, from_top(SEARCH_HEIGHT, SPACER), &rsearch, &rlists);
+    return count_rows(rlists, FONT_SPACE);
 }
 
 /*
@@ -1377,35 +1895,29 @@ static void draw_index(SDL_Surface *surface, const struct rect rect,
  */
 
 static void draw_library(SDL_Surface *surface, const struct rect *rect,
-                         struct selector *sel)
+                         const struct scene *sc)
 {
     struct rect rsearch, rlists, rcrates, rrecords;
-    unsigned int rows;
 
-    split(*rect, from_top(SEARCH_HEIGHT, SPACER), &rsearch, &rlists);
-
-    rows = count_rows(rlists, FONT_SPACE);
-    if (rows == 0) {
+    if (library_rows(rect) == 0) {
 
         /* Hide the selector: draw nothing, and make it a 'virtual'
          * one row selector. This is enough to use it from the search
          * field and status only */
 
-        draw_search(surface, rect, sel);
-        selector_set_lines(sel, 1);
-
+        draw_search(surface, rect, sc);
         return;
     }
 
-    draw_search(surface, &rsearch, sel);
-    selector_set_lines(sel, rows);
+    split(*rect, from_top(SEARCH_HEIGHT, SPACER), &rsearch, &rlists);
+    draw_search(surface, &rsearch, sc);
 
     split(rlists, columns(0, 4, SPACER), &rcrates, &rrecords);
     if (rcrates.w > LIBRARY_MIN_WIDTH) {
-        draw_index(surface, rrecords, sel);
-        draw_crates(surface, rcrates, sel);
+        draw_index(surface, rrecords, sc);
+        draw_crates(surface, rcrates, sc);
     } else {
-        draw_index(surface, *rect, sel);
+        draw_index(surface, *rect, sc);
     }
 }
 
@@ -1420,56 +1932,199 @@ static SDL_Rect to_sdl_rect(struct rect ours)
 }
 
 /*
- * Draw the interface, using a bitmask to optimise which areas
+ * Copy the visible part of the library
+ *
+ * Return: -1 if not enough memory, otherwise 0
  */
 
-static void draw(SDL_Surface *surface, unsigned int redraw)
+static int capture_library(struct scene *sc, struct selector *sel)
 {
-    SDL_Rect areas[3], *damaged = areas;
-    struct rect whole, rworkspace, rplayers, rlibrary, rstatus, rtmp;
+    size_t rows, n;
+    const struct index *view;
+
+    rows = sel->records.lines;
+
+    if (rows > sc->rows) {
+        struct scene_crate *c;
+        struct record **r;
+
+        c = realloc(sc->crate, sizeof *sc->crate * rows);
+        if (c == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        sc->crate = c;
+
+        r = realloc(sc->record, sizeof *sc->record * rows);
+        if (r == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        sc->record = r;
+
+        sc->rows = rows;
+    }
+
+    view = sel->view_index;
+
+    sc->sort = sel->sort;
+    strcpy(sc->search, sel->search);
+    sc->matches = view->entries;
+    sc->crates = sel->crates;
+    sc->records = sel->records;
+
+    for (n = 0; n < rows; n++) {
+        int e;
+
+        e = listbox_map(&sel->crates, n);
+        if (e != -1) {
+            const struct crate *c = sel->library->crate[e];
+
+            sc->crate[n].name = c->name;
+            sc->crate[n].is_fixed = c->is_fixed;
+            sc->crate[n].is_busy = c->is_busy;
+        }
+
+        e = listbox_map(&sel->records, n);
+        if (e != -1)
+            sc->record[n] = view->record[e];
+    }
+
+    return 0;
+}
+
+/*
+ * Drop the references held by a scene
+ *
+ * Pre: rig lock is held
+ */
+
+static void release_scene(struct scene *sc)
+{
+    size_t d;
+
+    for (d = 0; d < ndeck; d++) {
+        if (sc->track[d] != NULL) {
+            track_release(sc->track[d]);
+            sc->track[d] = NULL;
+        }
+    }
+}
+
+/*
+ * Take from the rig everything which is needed to draw the interface,
+ * using a bitmask to optimise which areas
+ *
+ * This is the only part of the drawing done with the lock held, and
+ * it is kept brief. Players are not copied, as the realtime thread
+ * updates them without the lock anyway.
+ *
+ * Pre: rig lock is held
+ */
+
+static void capture(struct scene *sc, SDL_Surface *surface,
+                    unsigned int redraw)
+{
+    size_t d;
+    struct rect rworkspace, rtmp;
 
     /* Split the display into the various areas. If an area is too
      * small, abandon any actions to happen in that area. */
 
-    whole = rect(0, 0, surface->w, surface->h, scale);
+    sc->whole = rect(0, 0, surface->w, surface->h, scale);
     rworkspace = shrink(rect(0, 0, surface->w, surface->h, scale), BORDER);
 
-    split(rworkspace, from_bottom(STATUS_HEIGHT, SPACER), &rtmp, &rstatus);
+    split(rworkspace, from_bottom(STATUS_HEIGHT, SPACER), &rtmp, &sc->status);
     if (rtmp.h < 128 || rtmp.w < 0) {
         rtmp = rworkspace;
         redraw &= ~REDRAW_STATUS;
     }
 
-    split(rtmp, from_top(PLAYER_HEIGHT, SPACER), &rplayers, &rlibrary);
-    if (rlibrary.h < LIBRARY_MIN_HEIGHT || rlibrary.w < LIBRARY_MIN_WIDTH) {
-        rplayers = rtmp;
+    split(rtmp, from_top(PLAYER_HEIGHT, SPACER), &sc->players, &sc->library);
+    if (sc->library.h < LIBRARY_MIN_HEIGHT
+        || sc->library.w < LIBRARY_MIN_WIDTH)
+    {
+        sc->players = rtmp;
         redraw &= ~REDRAW_LIBRARY;
     }
 
-    if (rplayers.h < 0 || rplayers.w < 0)
+    if (sc->players.h < 0 || sc->players.w < 0)
         redraw &= ~REDRAW_DECKS;
 
+    if (redraw & REDRAW_LIBRARY) {
+        unsigned int rows;
+
+        rows = library_rows(&sc->library);
+        selector_set_lines(&selector, rows > 0 ? rows : 1);
+
+        if (capture_library(sc, &selector) == -1)
+            redraw &= ~REDRAW_LIBRARY;
+    }
+
+    if (redraw & REDRAW_STATUS) {
+        sc->status_level = status_level();
+        snprintf(sc->message, sizeof sc->message, "%s", status());
+    }
+
+    release_scene(sc);
+
+    if (redraw & REDRAW_DECKS) {
+        for (d = 0; d < ndeck; d++) {
+            sc->track[d] = deck[d].player.track;
+            track_acquire(sc->track[d]);
+            sc->loaded[d] = deck[d].record;
+        }
+    }
+
+    sc->redraw = redraw;
+}
+
+/*
+ * Draw the interface from the scene, without the rig lock
+ */
+
+static void draw(SDL_Surface *surface, const struct scene *sc)
+{
+    SDL_Rect areas[3], *damaged = areas;
+    unsigned int redraw;
+    Uint64 start;
+
+    redraw = sc->redraw;
     if (!redraw)
         return;
 
+    trace_begin("draw");
+    start = SDL_GetPerformanceCounter();
+
     LOCK(surface);
 
-    if (redraw & REDRAW_BACKGROUND)
-        draw_rect(surface, &whole, background_col);
+    if (redraw & REDRAW_BACKGROUND) {
+        draw_rect(surface, &sc->whole, background_col);
+        forget_meters();
+    }
 
     if (redraw & REDRAW_LIBRARY) {
-        draw_library(surface, &rlibrary, &selector);
-        *damaged++ = to_sdl_rect(rlibrary);
+        Uint64 library = SDL_GetPerformanceCounter();
+
+        draw_library(surface, &sc->library, sc);
+        *damaged++ = to_sdl_rect(sc->library);
+        account(&stats.library, library);
     }
 
     if (redraw & REDRAW_STATUS) {
-        draw_status(surface, &rstatus);
-        *damaged++ = to_sdl_rect(rstatus);
+        Uint64 status = SDL_GetPerformanceCounter();
+
+        draw_status(surface, &sc->status, sc);
+        *damaged++ = to_sdl_rect(sc->status);
+        account(&stats.status, status);
     }
 
     if (redraw & REDRAW_DECKS) {
-        draw_decks(surface, &rplayers, deck, ndeck, meter_scale);
-        *damaged++ = to_sdl_rect(rplayers);
+        Uint64 decks = SDL_GetPerformanceCounter();
+
+        draw_decks(surface, &sc->players, sc, deck, ndeck, meter_scale);
+        *damaged++ = to_sdl_rect(sc->players);
+        account(&stats.decks, decks);
     }
 
     UNLOCK(surface);
@@ -1481,6 +2136,10 @@ static void draw(SDL_Surface *surface, unsigned int redraw)
         (void)SDL_UpdateWindowSurface(window);
     else
         (void)SDL_UpdateWindowSurfaceRects(window, areas, damaged - areas);
+
+    stats.frames++;
+    account(&stats.drawing, start);
+    trace_end("draw");
 }
 
 /*
@@ -1550,7 +2209,7 @@ static bool handle_key(SDL_Keycode key, Uint16 mod)
     } else if (key == SDLK_TAB) {
         if (mod & KMOD_CTRL) {
             if (mod & KMOD_SHIFT)
-                selector_rescan(sel);
+                selector_rescan(sel, mod & KMOD_ALT);
             else
                 selector_toggle_order(sel);
         } else {
@@ -1623,6 +2282,10 @@ static bool handle_key(SDL_Keycode key, Uint16 mod)
                     (void)player_toggle_timecode_control(pl);
                 }
                 break;
+
+            case FUNC_TELEMETRY:
+                telemetry[d].show = !telemetry[d].show;
+                break;
             }
         }
     }
@@ -1637,6 +2300,7 @@ static bool handle_key(SDL_Keycode key, Uint16 mod)
 static SDL_Surface* set_size(void)
 {
     SDL_Surface *surface;
+    SDL_DisplayMode mode;
 
     surface = SDL_GetWindowSurface(window);
     if (surface == NULL) {
@@ -1647,28 +2311,169 @@ static SDL_Surface* set_size(void)
     fprintf(stderr, "New interface size is %dx%d.\n",
             surface->w, surface->h);
 
+    /* No need to refresh faster than the display */
+
+    active_refresh = REFRESH;
+
+    if (SDL_GetWindowDisplayMode(window, &mode) == 0
+        && mode.refresh_rate > 0
+        && 1000 / mode.refresh_rate > REFRESH)
+    {
+        active_refresh = 1000 / mode.refresh_rate;
+    }
+
     return surface;
 }
 
-static void push_event(int t)
+/*
+ * Return: false if the event was already waiting, otherwise true
+ */
+
+static bool push_event(int t)
 {
     SDL_Event e;
 
-    if (!SDL_PeepEvents(&e, 1, SDL_PEEKEVENT, t, t)) {
-        e.type = t;
-        if (SDL_PushEvent(&e) == -1)
-            abort();
+    if (SDL_PeepEvents(&e, 1, SDL_PEEKEVENT, t, t))
+        return false;
+
+    e.type = t;
+    if (SDL_PushEvent(&e) == -1)
+        abort();
+
+    return true;
+}
+
+/*
+ * Refresh the signal quality of each deck, and log it periodically
+ */
+
+static void update_telemetry(void)
+{
+    size_t d;
+    Uint32 now;
+
+    now = SDL_GetTicks();
+
+    for (d = 0; d < ndeck; d++) {
+        struct telemetry *t = &telemetry[d];
+        struct timecoder *tc = &deck[d].timecoder;
+
+        if (now - t->updated >= TELEMETRY_UPDATE) {
+            timecoder_get_quality(tc, &t->since_update, &t->quality);
+            t->updated = now;
+        }
+
+        if (now - t->logged >= TELEMETRY_LOG) {
+            struct timecoder_quality q;
+            char buf[128];
+
+            timecoder_get_quality(tc, &t->since_log, &q);
+            t->logged = now;
+
+            if (!deck[d].player.timecode_control)
+                continue;
+
+            format_quality(buf, &q);
+            fprintf(stderr, "Deck %zd %s: %s\n", d, tc->def->name, buf);
+        }
     }
 }
 
+/*
+ * Log the performance of the interface periodically, while the
+ * telemetry of any deck is shown
+ */
+
+static void log_stats(void)
+{
+    size_t d;
+    Uint32 now;
+    unsigned long lookups, missed;
+    double ms;
+    bool show;
+    struct rig_stats lock;
+
+    now = SDL_GetTicks();
+    if (now - stats.logged < TELEMETRY_LOG)
+        return;
+
+    stats.logged = now;
+    lookups = stats.text_hits + stats.text_misses;
+    missed = __sync_fetch_and_and(&stats.missed, 0);
+
+    show = false;
+    for (d = 0; d < ndeck; d++)
+        show |= telemetry[d].show;
+
+    rig_stats(&lock);
+
+    if (!show) {
+        reset_stats();
+        return;
+    }
+
+    if (stats.frames > 0 && lookups > 0) {
+        ms = 1000.0 / SDL_GetPerformanceFrequency() / stats.frames;
+
+        fprintf(stderr, "Interface: %lu frames, %.2fms each, %lu missed, "
+                "refresh %ums; %lu text renderings, %.1f%% from cache\n",
+                stats.frames, stats.drawing * ms, missed, refresh,
+                lookups, 100.0 * stats.text_hits / lookups);
+
+        for (d = 0; d < ndeck; d++) {
+            if (telemetry[d].show) {
+                fprintf(stderr, "Deck %zd: %.2fms each frame\n",
+                        d, stats.deck[d] * ms);
+            }
+        }
+    }
+
+    if (lock.taken > 0) {
+        fprintf(stderr, "Rig lock: taken %lu times, %lu contended; "
+                "%.2fms held and %.2fms waiting on average\n",
+                lock.taken, lock.contended,
+                1000.0 * lock.held / lock.taken,
+                1000.0 * lock.waited / lock.taken);
+    }
+
+    reset_stats();
+}
+
 /*
  * Timer which posts a screen redraw event
  */
 
 static Uint32 ticker(Uint32 interval, void *p)
 {
-    push_event(EVENT_TICKER);
-    return interval;
+    if (!push_event(EVENT_TICKER))
+        __sync_fetch_and_add(&stats.missed, 1);
+
+    return refresh;
+}
+
+/*
+ * Set the rate of the ticker; slow it down once nothing on the decks
+ * has moved for a while
+ */
+
+static void pace(void)
+{
+    size_t d;
+    Uint32 now;
+
+    now = SDL_GetTicks();
+
+    for (d = 0; d < ndeck; d++) {
+        struct player *pl = &deck[d].player;
+
+        if (player_is_active(pl) || track_is_importing(pl->track))
+            moved = now;
+    }
+
+    if (now - moved < IDLE_AFTER)
+        refresh = active_refresh;
+    else
+        refresh = IDLE_REFRESH;
 }
 
 /*
@@ -1731,6 +2536,9 @@ static bool handle_sdl_event(SDL_Event *event,
         break;
 
     case EVENT_TICKER:
+        update_telemetry();
+        log_stats();
+        pace();
         *redraw |= REDRAW_DECKS;
         break;
 
@@ -1775,29 +2583,32 @@ static int interface_main(void)
 
     timer = SDL_AddTimer(REFRESH, ticker, NULL);
 
-    rig_lock();
-
     for (;;) {
         unsigned int redraw = 0;
         SDL_Event event;
 
-        rig_unlock();
-
         if (SDL_WaitEvent(&event) < 0)
             break;
 
         rig_lock();
 
         do {
-            if (!handle_sdl_event(&event, &redraw, &surface))
+            if (!handle_sdl_event(&event, &redraw, &surface)) {
+                rig_unlock();
                 goto finish;
+            }
 
         } while (SDL_PollEvent(&event) > 0);
 
-        draw(surface, redraw);
+        capture(&scene, surface, redraw);
+        rig_unlock();
+
+        draw(surface, &scene);
     }
 
  finish:
+    rig_lock();
+    release_scene(&scene);
     rig_unlock();
 
     SDL_RemoveTimer(timer);
@@ -1807,6 +2618,7 @@ static int interface_main(void)
 
 static void* launch(void *p)
 {
+    trace_thread("interface");
     interface_main();
     return NULL;
 }
@@ -1895,6 +2707,8 @@ static void cleanup()
     ignore(&on_status);
     ignore(&on_selector);
     selector_clear(&selector);
+    forget_meters();
+    clear_text_cache();
     clear_fonts();
 
     if (iconv_close(utf) == -1)
@@ -1905,10 +2719,12 @@ static void cleanup()
 }
 
 /*
- * Start the SDL interface
+ * Initialise the SDL interface, without starting its thread
+ *
+ * Return: 0 on success, otherwise -1
  */
 
-int interface_start(struct library *lib, const char *geo, bool decor)
+int interface_init(struct library *lib, const char *geo, bool decor)
 {
     int x = SDL_WINDOWPOS_UNDEFINED,
         y = SDL_WINDOWPOS_UNDEFINED,
@@ -1986,11 +2802,30 @@ int interface_start(struct library *lib, const char *geo, bool decor)
             not_implemented();
     }
 
+    init_text_cache();
     selector_init(&selector, lib);
     watch(&on_status, &status_changed, defer_status_redraw);
     watch(&on_selector, &selector.changed, defer_selector_redraw);
     status_set(STATUS_VERBOSE, banner);
 
+    return 0;
+
+fail_sdl:
+    SDL_Quit();
+fail_fonts:
+    TTF_Quit();
+    return -1;
+}
+
+/*
+ * Start the SDL interface
+ */
+
+int interface_start(struct library *lib, const char *geo, bool decor)
+{
+    if (interface_init(lib, geo, decor) == -1)
+        return -1;
+
     fprintf(stderr, "Launching interface thread...\n");
 
     if (pthread_create(&ph, NULL, launch, NULL)) {
@@ -2000,12 +2835,73 @@ int interface_start(struct library *lib, const char *geo, bool decor)
     }
 
     return 0;
+}
 
-fail_sdl:
-    SDL_Quit();
-fail_fonts:
-    TTF_Quit();
-    return -1;
+/*
+ * Draw a single frame of the interface from the current rig, in the
+ * calling thread; used to measure the drawing
+ *
+ * Pre: interface is initialised, but its thread is not running
+ */
+
+void interface_draw(bool full)
+{
+    SDL_Surface *surface;
+    unsigned int redraw;
+
+    surface = SDL_GetWindowSurface(window);
+    if (surface == NULL) {
+        fprintf(stderr, "%s\n", SDL_GetError());
+        return;
+    }
+
+    redraw = REDRAW_DECKS | REDRAW_STATUS | REDRAW_LIBRARY;
+    if (full)
+        redraw |= REDRAW_BACKGROUND;
+
+    rig_lock();
+    capture(&scene, surface, redraw);
+    rig_unlock();
+
+    draw(surface, &scene);
+}
+
+/*
+ * Take the time spent drawing since the previous call
+ *
+ * Post: t is the time spent in each area of the interface, in seconds
+ */
+
+void interface_timing(struct interface_timing *t)
+{
+    double f;
+
+    f = 1.0 / SDL_GetPerformanceFrequency();
+
+    t->frames = stats.frames;
+    t->total = stats.drawing * f;
+    t->library = stats.library * f;
+    t->status = stats.status * f;
+    t->decks = stats.decks * f;
+    t->meters = stats.meters * f;
+    t->scope = stats.scope * f;
+    t->spinner = stats.spinner * f;
+    t->text = stats.text * f;
+
+    reset_stats();
+}
+
+/*
+ * Release an interface which was initialised but not started
+ */
+
+void interface_clear(void)
+{
+    rig_lock();
+    release_scene(&scene);
+    rig_unlock();
+
+    cleanup();
 }
 
 /*
@@ -23,7 +23,20 @@
 #include "deck.h"
 #include "library.h"
 
+/* Time spent drawing the interface, in seconds; text is also
+ * counted in the area it is part of */
+
+struct interface_timing {
+    unsigned long frames;
+    double total, library, status, decks, meters, scope, spinner, text;
+};
+
 int interface_start(struct library *lib, const char *geo, bool decor);
 void interface_stop();
 
+int interface_init(struct library *lib, const char *geo, bool decor);
+void interface_draw(bool full);
+void interface_timing(struct interface_timing *t);
+void interface_clear(void);
+
 #endif
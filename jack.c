@@ -25,6 +25,7 @@
 
 #include "device.h"
 #include "jack.h"
+#include "trace.h"
 
 #define MAX_BLOCK 512 /* samples */
 #define SCALE 32768
@@ -139,6 +140,13 @@ static int process_callback(jack_nframes_t nframes, void *local)
     return 0;
 }
 
+/* Called in the thread of the process callback before it runs */
+
+static void thread_init_callback(void *local)
+{
+    trace_thread("jack");
+}
+
 /* Shutdown callback */
 
 static void shutdown_callback(void *local)
@@ -167,6 +175,13 @@ static int start_jack_client(void)
         return -1;
     }
 
+    if (jack_set_thread_init_callback(client, thread_init_callback,
+                                      NULL) != 0)
+    {
+        fprintf(stderr, "JACK: Failed to set thread init callback\n");
+        return -1;
+    }
+
     jack_on_shutdown(client, shutdown_callback, NULL);
 
     rate = jack_get_sample_rate(client);
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Linear Feedback Shift Register used to generate and decode the
+ * bitstream of a timecode
+ */
+
+#ifndef LFSR_H
+#define LFSR_H
+
+typedef unsigned int bits_t;
+
+/*
+ * Calculate LFSR bit
+ */
+
+static inline bits_t lfsr(bits_t code, bits_t taps)
+{
+    bits_t taken;
+    int xrs;
+
+    taken = code & taps;
+    xrs = 0;
+    while (taken != 0x0) {
+        xrs += taken & 0x1;
+        taken >>= 1;
+    }
+
+    return xrs & 0x1;
+}
+
+/*
+ * Linear Feedback Shift Register in the forward direction. New values
+ * are generated at the most-significant bit.
+ */
+
+static inline bits_t lfsr_fwd(bits_t current, bits_t taps, unsigned int nbits)
+{
+    bits_t l;
+
+    /* New bits are added at the MSB; shift right by one */
+
+    l = lfsr(current, taps | 0x1);
+    return (current >> 1) | (l << (nbits - 1));
+}
+
+/*
+ * Linear Feedback Shift Register in the reverse direction
+ */
+
+static inline bits_t lfsr_rev(bits_t current, bits_t taps, unsigned int nbits)
+{
+    bits_t l, mask;
+
+    /* New bits are added at the LSB; shift left one and mask */
+
+    mask = (1 << nbits) - 1;
+    l = lfsr(current, (taps >> 1) | (0x1 << (nbits - 1)));
+    return ((current << 1) & mask) | l;
+}
+
+#endif
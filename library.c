@@ -24,14 +24,17 @@
 #include <libgen.h> /*  basename() */
 #include <math.h> /* isfinite() */
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "excrate.h"
 #include "external.h"
+#include "snapshot.h"
 
 #define CRATE_ALL "All records"
+#define SMALL 4096 /* entries below which a batch is added one by one */
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
 
@@ -75,7 +78,13 @@ void listing_init(struct listing *l)
     index_init(&l->by_artist);
     index_init(&l->by_bpm);
     index_init(&l->by_order);
+    trigram_init(&l->trigram);
     event_init(&l->addition);
+    event_init(&l->removal);
+    arena_init(&l->arena);
+    l->artists.slot = NULL;
+    l->artists.size = 0;
+    l->artists.entries = 0;
 }
 
 void listing_clear(struct listing *l)
@@ -83,7 +92,11 @@ void listing_clear(struct listing *l)
     index_clear(&l->by_artist);
     index_clear(&l->by_bpm);
     index_clear(&l->by_order);
+    trigram_clear(&l->trigram);
     event_clear(&l->addition);
+    event_clear(&l->removal);
+    arena_clear(&l->arena);
+    free(l->artists.slot); /* may be NULL */
 }
 
 /*
@@ -103,6 +116,7 @@ static int crate_init(struct crate *c, const char *name)
     }
 
     c->is_busy = false;
+    c->saving = NULL;
 
     event_init(&c->activity);
     event_init(&c->refresh);
@@ -122,6 +136,17 @@ static void propagate_addition(struct observer *o, void *x)
     fire(&c->addition, x);
 }
 
+/*
+ * Propagate removal of records from the listing, as a refresh of
+ * this crate
+ */
+
+static void propagate_removal(struct observer *o, void *x)
+{
+    struct crate *c = container_of(o, struct crate, on_removal);
+    fire(&c->refresh, NULL);
+}
+
 /*
  * Propagate notification that the scan has finished
  */
@@ -129,6 +154,31 @@ static void propagate_addition(struct observer *o, void *x)
 static void propagate_completion(struct observer *o, void *x)
 {
     struct crate *c = container_of(o, struct crate, on_completion);
+    struct listing *snapshot;
+
+    snapshot = c->snapshot;
+
+    if (snapshot != NULL) {
+        ignore(&c->on_addition);
+        ignore(&c->on_removal);
+        c->snapshot = NULL;
+        c->listing = &c->excrate->listing;
+        fire(&c->refresh, NULL);
+        watch(&c->on_addition, &c->listing->addition, propagate_addition);
+        watch(&c->on_removal, &c->listing->removal, propagate_removal);
+
+        listing_clear(snapshot);
+        free(snapshot);
+    }
+
+    /* Save outside of the rig thread, which holds the lock */
+
+    if (c->excrate->succeeded) {
+        if (c->saving != NULL)
+            snapshot_finish(c->saving);
+        c->saving = snapshot_start(c->listing, c->scan, c->path);
+    }
+
     c->is_busy = false;
     fire(&c->activity, NULL);
 }
@@ -146,7 +196,9 @@ static int crate_init_all(struct library *l, struct crate *c, const char *name)
 
     c->is_fixed = true;
     c->listing = &l->storage;
+    c->snapshot = NULL;
     watch(&c->on_addition, &c->listing->addition, propagate_addition);
+    watch(&c->on_removal, &c->listing->removal, propagate_removal);
     c->excrate = NULL;
 
     return 0;
@@ -163,11 +215,15 @@ static void hook_up_excrate(struct crate *c, struct excrate *e)
         fire(&c->activity, NULL);
     }
 
+    /* Until the scan completes, a snapshot is more complete than
+     * the scan */
+
     c->excrate = e;
-    c->listing = &e->listing;
+    c->listing = c->snapshot ? c->snapshot : &e->listing;
     fire(&c->refresh, NULL);
 
     watch(&c->on_addition, &c->listing->addition, propagate_addition);
+    watch(&c->on_removal, &c->listing->removal, propagate_removal);
     watch(&c->on_completion, &e->completion, propagate_completion);
 }
 
@@ -192,10 +248,16 @@ static int crate_init_scan(struct library *l, struct crate *c, const char *name,
     c->is_fixed = false;
     c->scan = scan;
     c->path = path;
+    c->snapshot = snapshot_load(&l->storage, scan, path);
 
-    e = excrate_acquire_by_scan(scan, path, &l->storage);
-    if (e == NULL)
+    e = excrate_acquire_by_scan(scan, path, &l->storage, NULL);
+    if (e == NULL) {
+        if (c->snapshot != NULL) {
+            listing_clear(c->snapshot);
+            free(c->snapshot);
+        }
         return -1;
+    }
 
     hook_up_excrate(c, e);
 
@@ -205,23 +267,32 @@ static int crate_init_scan(struct library *l, struct crate *c, const char *name,
 /*
  * Re-run a crate which has a scan as its source
  *
+ * Unless a full rescan is requested, a crate whose scan completed
+ * is updated with only the changes since.
+ *
  * Return: 0 on success, -1 on error
  */
 
-static int crate_rescan(struct crate *c, struct library *l)
+static int crate_rescan(struct crate *c, struct library *l, bool full)
 {
     struct excrate *e;
+    const struct listing *base;
 
     assert(c->excrate != NULL);
 
+    base = NULL;
+    if (!full && c->snapshot == NULL && c->excrate->succeeded)
+        base = &c->excrate->listing;
+
     /* Replace the excrate in-place. Care needed to re-wire
      * everything back up again as before */
 
-    e = excrate_acquire_by_scan(c->scan, c->path, &l->storage);
+    e = excrate_acquire_by_scan(c->scan, c->path, &l->storage, base);
     if (e == NULL)
         return -1;
 
     ignore(&c->on_completion);
+    ignore(&c->on_removal);
     ignore(&c->on_addition);
     excrate_release(c->excrate);
     hook_up_excrate(c, e);
@@ -239,12 +310,21 @@ static int crate_rescan(struct crate *c, struct library *l)
 static void crate_clear(struct crate *c)
 {
     ignore(&c->on_addition);
+    ignore(&c->on_removal);
 
     if (c->excrate != NULL) {
         ignore(&c->on_completion);
         excrate_release(c->excrate);
     }
 
+    if (c->snapshot != NULL) {
+        listing_clear(c->snapshot);
+        free(c->snapshot);
+    }
+
+    if (c->saving != NULL)
+        snapshot_finish(c->saving);
+
     event_clear(&c->activity);
     event_clear(&c->refresh);
     event_clear(&c->addition);
@@ -265,6 +345,61 @@ static int crate_cmp(const struct crate *a, const struct crate *b)
     return strcmp(a->name, b->name);
 }
 
+/*
+ * Give a record which is new to the library its search key, if it
+ * does not have one; on failure the record is searched more slowly
+ *
+ * The key lasts as long as this listing, which must be the first
+ * and longest-lived to take the record.
+ */
+
+static void add_key(struct listing *l, struct record *r)
+{
+    if (r->key == NULL)
+        (void)record_key(r, &l->arena);
+}
+
+/*
+ * Notify observers of the records added to the end of by_order,
+ * beyond the given position
+ */
+
+static void announce(struct listing *l, size_t from)
+{
+    struct additions a;
+
+    a.record = l->by_order.record + from;
+    a.entries = l->by_order.entries - from;
+
+    if (a.entries > 0)
+        fire(&l->addition, &a);
+}
+
+/*
+ * Insert a record into the indexes of a listing
+ *
+ * Return: the existing entry, or r if it was added
+ * Pre: an entry is reserved in each index
+ */
+
+static struct record* insert(struct listing *l, struct record *r)
+{
+    struct record *x;
+
+    x = index_insert(&l->by_artist, r, SORT_ARTIST);
+    assert(x != NULL);
+    if (x != r)
+        return x;
+
+    x = index_insert(&l->by_bpm, r, SORT_BPM);
+    assert(x == r);
+
+    index_add(&l->by_order, r);
+    add_key(l, r);
+
+    return r;
+}
+
 /*
  * Add a record into a crate and its various indexes
  *
@@ -288,20 +423,382 @@ struct record* listing_add(struct listing *l, struct record *r)
     if (index_reserve(&l->by_order, 1) == -1)
         return NULL;
 
-    x = index_insert(&l->by_artist, r, SORT_ARTIST);
-    assert(x != NULL);
+    x = insert(l, r);
     if (x != r)
         return x;
 
-    x = index_insert(&l->by_bpm, r, SORT_BPM);
-    assert(x == r);
-
-    index_add(&l->by_order, r);
+    trigram_update(&l->trigram, &l->by_order);
 
-    fire(&l->addition, r);
+    announce(l, l->by_order.entries - 1);
     return r;
 }
 
+/*
+ * Comparison of pointer values, see qsort(3) and bsearch(3)
+ */
+
+static int ptrcompar(const void *a, const void *b)
+{
+    const struct record *x = *(struct record**)a, *y = *(struct record**)b;
+
+    if (x < y)
+        return -1;
+    if (x > y)
+        return 1;
+    return 0;
+}
+
+/*
+ * Add a batch of records into a crate and its various indexes
+ *
+ * Equivalent to listing_add() of each record in turn, but the new
+ * records are sorted and merged into the indexes; much faster when
+ * adding to a large listing. Observers are notified once, of the
+ * whole batch.
+ *
+ * Return: 0 on success, -1 if out of memory
+ * Post: on success, each r[n] is replaced by the entry in the listing,
+ * which is an existing entry if the record was a duplicate
+ */
+
+int listing_add_batch(struct listing *l, struct record **r, size_t n)
+{
+    size_t i, j, m, added, before;
+    bool *done;
+    struct record **fresh, **order;
+
+    if (n == 0)
+        return 0;
+
+    /* Do all the memory allocation up-front as we can't un-wind if
+     * it errors later */
+
+    if (index_reserve(&l->by_artist, n) == -1)
+        return -1;
+    if (index_reserve(&l->by_bpm, n) == -1)
+        return -1;
+    if (index_reserve(&l->by_order, n) == -1)
+        return -1;
+
+    before = l->by_order.entries;
+
+    /* Into a small listing, moving the entries for each record costs
+     * less than sorting the batch */
+
+    if (before + n < SMALL) {
+        for (i = 0; i < n; i++)
+            r[i] = insert(l, r[i]);
+
+        trigram_update(&l->trigram, &l->by_order);
+        announce(l, before);
+        return 0;
+    }
+
+    fresh = malloc(sizeof(struct record*) * n * 2);
+    if (fresh == NULL) {
+        perror("malloc");
+        return -1;
+    }
+
+    done = calloc(n, sizeof *done);
+    if (done == NULL) {
+        perror("calloc");
+        free(fresh);
+        return -1;
+    }
+
+    /* Records already in the listing are the usual case on a
+     * rescan, and are found as quickly as by listing_add(); only
+     * the rest are sorted and merged */
+
+    order = fresh + n;
+    m = 0;
+
+    for (i = 0; i < n; i++) {
+        struct record *x;
+
+        x = index_lookup(&l->by_artist, r[i], SORT_ARTIST);
+        if (x == NULL)
+            order[m++] = r[i];
+        else
+            r[i] = x;
+    }
+
+    if (m == 0)
+        goto out;
+
+    memcpy(fresh, order, sizeof(struct record*) * m);
+
+    /* Of duplicates within the batch, keep the first as listing_add()
+     * would; the others are then treated like any other duplicate */
+
+    index_sort(fresh, m, SORT_ARTIST);
+    added = index_unique(fresh, m, order, SORT_ARTIST);
+    i = index_merge(&l->by_artist, fresh, added, SORT_ARTIST);
+    assert(i == added);
+
+    index_sort(fresh, added, SORT_BPM);
+    i = index_merge(&l->by_bpm, fresh, added, SORT_BPM);
+    assert(i == added);
+
+    /* Retain the original order of the batch; the new records are
+     * the ones which were not found above, in the same order */
+
+    qsort(fresh, added, sizeof *fresh, ptrcompar);
+
+    for (i = 0, j = 0; i < n && j < m; i++) {
+        struct record **x;
+        size_t z;
+
+        if (r[i] != order[j])
+            continue; /* already replaced by an existing entry */
+        j++;
+
+        x = bsearch(&r[i], fresh, added, sizeof *fresh, ptrcompar);
+        if (x == NULL) {
+            z = index_find(&l->by_artist, r[i], SORT_ARTIST);
+            assert(z < l->by_artist.entries);
+            r[i] = l->by_artist.record[z];
+            continue;
+        }
+
+        if (done[x - fresh])
+            continue;
+        done[x - fresh] = true;
+
+        index_add(&l->by_order, r[i]);
+        add_key(l, r[i]);
+    }
+
+    trigram_update(&l->trigram, &l->by_order);
+    announce(l, before);
+
+out:
+    free(done);
+    free(fresh);
+
+    return 0;
+}
+
+/*
+ * Add records to an empty listing, given the order of each index as
+ * positions in r[]
+ *
+ * The orders are those of an earlier listing, and save sorting the
+ * records again. They are checked, as the collation may have changed
+ * since; if not valid, the records are sorted after all.
+ *
+ * Return: 0 on success, -1 if out of memory
+ * Post: on success, r[] is as for listing_add_batch()
+ */
+
+int listing_add_sorted(struct listing *l, struct record **r, size_t n,
+                       const uint32_t *artist, const uint32_t *bpm)
+{
+    size_t i;
+
+    assert(l->by_order.entries == 0);
+
+    if (index_reserve(&l->by_artist, n) == -1)
+        return -1;
+    if (index_reserve(&l->by_bpm, n) == -1)
+        return -1;
+    if (index_reserve(&l->by_order, n) == -1)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        if (artist[i] >= n || bpm[i] >= n)
+            break;
+
+        index_add(&l->by_artist, r[artist[i]]);
+        index_add(&l->by_bpm, r[bpm[i]]);
+    }
+
+    if (i < n
+        || !index_is_sorted(&l->by_artist, SORT_ARTIST)
+        || !index_is_sorted(&l->by_bpm, SORT_BPM))
+    {
+        index_blank(&l->by_artist);
+        index_blank(&l->by_bpm);
+        return listing_add_batch(l, r, n);
+    }
+
+    for (i = 0; i < n; i++) {
+        index_add(&l->by_order, r[i]);
+        add_key(l, r[i]);
+    }
+
+    trigram_update(&l->trigram, &l->by_order);
+
+    announce(l, 0);
+    return 0;
+}
+
+/*
+ * Make an empty listing into a copy of another
+ *
+ * The records are shared, and have their keys already.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+
+int listing_copy(struct listing *l, const struct listing *src)
+{
+    assert(l->by_order.entries == 0);
+
+    if (index_copy(&src->by_artist, &l->by_artist) == -1)
+        return -1;
+    if (index_copy(&src->by_bpm, &l->by_bpm) == -1)
+        return -1;
+    if (index_copy(&src->by_order, &l->by_order) == -1)
+        return -1;
+
+    trigram_update(&l->trigram, &l->by_order);
+
+    return 0;
+}
+
+/*
+ * Remove from the index the records which are in the given set
+ */
+
+static void filter(struct index *i, struct record **set, size_t n)
+{
+    size_t x, y;
+
+    y = 0;
+
+    for (x = 0; x < i->entries; x++) {
+        if (bsearch(&i->record[x], set, n, sizeof *set, ptrcompar) == NULL)
+            i->record[y++] = i->record[x];
+    }
+
+    i->entries = y;
+}
+
+/*
+ * Remove a batch of records from a crate and its various indexes
+ *
+ * Records which are not in the listing are ignored. The records
+ * themselves are not freed, as they belong to the storage.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+
+int listing_remove_batch(struct listing *l, struct record **r, size_t n)
+{
+    size_t before;
+    struct record **set;
+
+    if (n == 0)
+        return 0;
+
+    set = malloc(sizeof *set * n);
+    if (set == NULL) {
+        perror("malloc");
+        return -1;
+    }
+
+    memcpy(set, r, sizeof *set * n);
+    qsort(set, n, sizeof *set, ptrcompar);
+
+    before = l->by_order.entries;
+
+    filter(&l->by_artist, set, n);
+    filter(&l->by_bpm, set, n);
+    filter(&l->by_order, set, n);
+
+    free(set);
+
+    if (l->by_order.entries == before)
+        return 0;
+
+    /* The trigram index refers to positions in by_order, so it is
+     * rebuilt; removals are not expected to be common */
+
+    trigram_clear(&l->trigram);
+    trigram_init(&l->trigram);
+    trigram_update(&l->trigram, &l->by_order);
+
+    fire(&l->removal, NULL);
+    return 0;
+}
+
+/*
+ * Return: the index of the listing in the given sort order
+ */
+
+struct index* listing_index(struct listing *l, int sort)
+{
+    switch (sort) {
+    case SORT_ARTIST:
+        return &l->by_artist;
+    case SORT_BPM:
+        return &l->by_bpm;
+    case SORT_PLAYLIST:
+        return &l->by_order;
+    default:
+        abort();
+    }
+}
+
+/*
+ * Find the records of the listing which match, in the given order
+ *
+ * The trigram index is used where it is likely to be quicker than
+ * checking every record of src; src is an index of the listing in
+ * the same order, which contains all the matches (eg. the result of
+ * a broader search) or NULL for the whole listing.
+ *
+ * Return: 0 on success, or -1 on memory allocation failure
+ * Post: on failure, dest is valid but incomplete
+ */
+
+int listing_match(struct listing *l, int sort, struct index *src,
+                  struct index *dest, const struct match *m)
+{
+    size_t estimate, scan, cost;
+
+    if (src == NULL)
+        src = listing_index(l, sort);
+
+    assert(src != dest);
+
+    estimate = trigram_estimate(&l->trigram, m);
+    if (estimate == SIZE_MAX)
+        return index_match(src, dest, m);
+
+    /* Costs are in units of checking a record in the order it was
+     * added, which is adjacent in memory to the next. In a sorted
+     * order each record is roughly three times the cost to reach;
+     * tests/search-bench shows this, and that a candidate from the
+     * index costs about one and a half */
+
+    scan = src->entries * (sort == SORT_PLAYLIST ? 2 : 6);
+    cost = estimate * 3;
+
+    /* Results come in the listing order; anything else is sorted,
+     * at a cost of roughly log2(n) comparisons per result */
+
+    if (sort != SORT_PLAYLIST) {
+        size_t x;
+
+        for (x = estimate; x > 1; x >>= 1)
+            cost += estimate * 2;
+    }
+
+    if (cost >= scan)
+        return index_match(src, dest, m);
+
+    if (trigram_match(&l->trigram, &l->by_order, dest, m) == -1)
+        return -1;
+
+    if (sort != SORT_PLAYLIST)
+        index_sort(dest->record, dest->entries, sort);
+
+    return 0;
+}
+
 /*
  * Comparison function, see qsort(3)
  */
@@ -388,34 +885,16 @@ int library_init(struct library *li)
     return 0;
 }
 
-/*
- * Free resources associated with a record
- */
-
-static void record_clear(struct record *re)
-{
-    free(re->pathname);
-    free(re->match); /* may be NULL */
-}
-
 /*
  * Free resources associated with the music library
+ *
+ * The records are in the arena of the storage, so are freed with it.
  */
 
 void library_clear(struct library *li)
 {
     int n;
 
-    /* This object is responsible for all the record pointers */
-
-    for (n = 0; n < li->storage.by_artist.entries; n++) {
-        struct record *re;
-
-        re = li->storage.by_artist.record[n];
-        record_clear(re);
-        free(re);
-    }
-
     /* Clear crates */
 
     for (n = 1; n < li->crates; n++) { /* skip the 'all' crate */
@@ -491,7 +970,8 @@ static size_t split(char *s, char *x[], size_t len)
  * Return: string with responsibility, or NULL if not required
  */
 
-static char* matchable(const char *artist, const char *title)
+static char* matchable(struct arena *a, const char *artist,
+                       const char *title)
 {
     char *buf, *in, *out;
     size_t len, fill, nonrev;
@@ -529,64 +1009,208 @@ static char* matchable(const char *artist, const char *title)
     if (nonrev == 0)
         return NULL;
 
-    return strdup(buf);
+    return arena_strdup(a, buf);
 }
 
 /*
- * Convert a line from the scan script to a record structure in memory
+ * Hash function for strings, FNV-1a
+ */
+
+static uint32_t hash(const char *s)
+{
+    uint32_t h;
+
+    h = 2166136261u;
+    while (*s != '\0') {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/*
+ * Enlarge the hash table of a set of strings
  *
- * Return: pointer to alloc'd record, or NULL on error
- * Post: if successful, responsibility for pointer line is taken
+ * Return: 0 on success, or -1 on memory allocation failure
  */
 
-struct record* get_record(char *line)
+static int enlarge_intern(struct intern *t)
+{
+    size_t n, size;
+    char **slot;
+
+    size = t->size ? t->size * 2 : 1024;
+
+    slot = calloc(size, sizeof *slot);
+    if (slot == NULL) {
+        perror("calloc");
+        return -1;
+    }
+
+    for (n = 0; n < t->size; n++) {
+        size_t z;
+
+        if (t->slot[n] == NULL)
+            continue;
+
+        z = hash(t->slot[n]) & (size - 1);
+        while (slot[z] != NULL)
+            z = (z + 1) & (size - 1);
+        slot[z] = t->slot[n];
+    }
+
+    free(t->slot);
+    t->slot = slot;
+    t->size = size;
+
+    return 0;
+}
+
+/*
+ * Share a single copy of each distinct string; many records have
+ * the same artist
+ *
+ * Return: string in the arena, or NULL if out of memory
+ */
+
+static char* intern(struct intern *t, struct arena *a, const char *s)
+{
+    size_t z;
+
+    if (t->entries * 2 >= t->size) {
+        if (enlarge_intern(t) == -1)
+            return NULL;
+    }
+
+    z = hash(s) & (t->size - 1);
+
+    while (t->slot[z] != NULL) {
+        if (strcmp(t->slot[z], s) == 0)
+            return t->slot[z];
+        z = (z + 1) & (t->size - 1);
+    }
+
+    t->slot[z] = arena_strdup(a, s);
+    if (t->slot[z] == NULL)
+        return NULL;
+
+    t->entries++;
+    return t->slot[z];
+}
+
+/*
+ * Find the given record in the storage, or allocate a copy of it
+ *
+ * Most records of a rescan are already known, and the existing
+ * record is returned. Otherwise a new record is allocated from the
+ * storage, for the caller to add to it. The strings of r are not
+ * retained.
+ *
+ * Return: pointer to record, or NULL on error
+ */
+
+struct record* store_record(struct listing *storage, struct record *r)
 {
-    int n;
     struct record *x;
-    char *field[4];
 
-    x = malloc(sizeof *x);
-    if (!x) {
-        perror("malloc");
+    x = index_lookup(&storage->by_artist, r, SORT_ARTIST);
+    if (x != NULL)
+        return x;
+
+    x = arena_alloc(&storage->arena, sizeof *x, sizeof(void*));
+    if (x == NULL)
         return NULL;
-    }
 
-    x->bpm = 0.0;
+    x->pathname = arena_strdup(&storage->arena, r->pathname);
+    x->artist = intern(&storage->artists, &storage->arena, r->artist);
+    x->title = arena_strdup(&storage->arena, r->title);
+
+    if (!x->pathname || !x->artist || !x->title)
+        return NULL;
+
+    x->bpm = r->bpm;
+    x->key = NULL;
+
+    /* Decide if this record needs a character-equivalent in the
+     * locale used for searching */
+
+    x->match = matchable(&storage->arena, x->artist, x->title);
+
+    return x;
+}
+
+/*
+ * Parse a line from the scan script (destructive)
+ *
+ * Return: 0 on success, or -1 if the line is malformed
+ * Post: on success, r refers to the fields of the line
+ */
+
+static int parse_line(char *line, struct record *r)
+{
+    int n;
+    char *field[4];
+
+    r->bpm = 0.0;
 
     n = split(line, field, ARRAY_SIZE(field));
 
     switch (n) {
     case 4:
-        x->bpm = parse_bpm(field[3]);
-        if (!isfinite(x->bpm)) {
+        r->bpm = parse_bpm(field[3]);
+        if (!isfinite(r->bpm)) {
             fprintf(stderr, "%s: Ignoring malformed BPM '%s'\n",
                     field[0], field[3]);
-            x->bpm = 0.0;
+            r->bpm = 0.0;
         }
         /* fall-through */
     case 3:
-        x->pathname = field[0];
-        x->artist = field[1];
-        x->title = field[2];
-        break;
+        r->pathname = field[0];
+        r->artist = field[1];
+        r->title = field[2];
+        return 0;
 
     case 2:
     case 1:
     default:
         fprintf(stderr, "Malformed record '%s'\n", line);
-        goto bad;
+        return -1;
     }
+}
 
-    /* Decide if this record needs a character-equivalent in the
-     * locale used for searching */
+/*
+ * Convert a line from the scan script to a record in the storage,
+ * see store_record(). The line is not retained.
+ *
+ * Return: pointer to record, or NULL on error
+ */
 
-    x->match = matchable(x->artist, x->title);
+struct record* get_record(struct listing *storage, char *line)
+{
+    struct record r;
 
-    return x;
+    if (parse_line(line, &r) == -1)
+        return NULL;
 
-bad:
-    free(x);
-    return NULL;
+    return store_record(storage, &r);
+}
+
+/*
+ * Find the record of the listing given by a line from the scan
+ * script. The line is not retained.
+ *
+ * Return: pointer to record, or NULL if there is no such record
+ */
+
+struct record* lookup_record(struct listing *l, char *line)
+{
+    struct record r;
+
+    if (parse_line(line, &r) == -1)
+        return NULL;
+
+    return index_lookup(&l->by_artist, &r, SORT_ARTIST);
 }
 
 /*
@@ -633,15 +1257,16 @@ fail:
  * Request a rescan on the given crate
  *
  * Only crates with an external source can be rescanned, others result
- * in a no-op.
+ * in a no-op. Unless full is set, only the changes since the last
+ * scan are applied, where possible.
  *
  * Return: -1 if scan is not possible, otherwise 0 on success
  */
 
-int library_rescan(struct library *l, struct crate *c)
+int library_rescan(struct library *l, struct crate *c, bool full)
 {
     if (!c->excrate)
         return -1;
     else
-        return crate_rescan(c, l);
+        return crate_rescan(c, l, full);
 }
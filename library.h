@@ -22,15 +22,39 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "index.h"
 #include "observer.h"
+#include "trigram.h"
+
+/* A set of distinct strings */
+
+struct intern {
+    char **slot;
+    size_t size, entries;
+};
+
+/* Records which have been added to a listing, given to the observers
+ * of its addition event; once for each batch */
+
+struct additions {
+    struct record **record;
+    size_t entries;
+};
 
 /* A set of records, with several optimised indexes */
 
 struct listing {
     struct index by_artist, by_bpm, by_order;
-    struct event addition;
+    struct trigram trigram; /* of by_order */
+    struct event addition, /* with struct additions */
+        removal;
+
+    /* Memory of the records which were first taken by this listing */
+
+    struct arena arena;
+    struct intern artists;
 };
 
 /* A single crate of records */
@@ -39,13 +63,19 @@ struct crate {
     bool is_fixed, is_busy;
     char *name;
     struct listing *listing;
-    struct observer on_addition, on_completion;
+    struct observer on_addition, on_removal, on_completion;
     struct event activity, /* at the crate level, not the listing */
         refresh, addition;
 
     /* Optionally, the corresponding source */
     const char *scan, *path;
     struct excrate *excrate;
+
+    /* The previous result of the scan, shown until it completes */
+    struct listing *snapshot; /* or NULL */
+
+    /* The latest result of the scan, being saved */
+    struct snapshot_writer *saving; /* or NULL */
 };
 
 /* The complete music library, which consists of multiple crates */
@@ -62,13 +92,23 @@ void library_global_clear(void);
 void listing_init(struct listing *l);
 void listing_clear(struct listing *l);
 struct record* listing_add(struct listing *l, struct record *r);
+int listing_add_batch(struct listing *l, struct record **r, size_t n);
+int listing_add_sorted(struct listing *l, struct record **r, size_t n,
+                       const uint32_t *artist, const uint32_t *bpm);
+int listing_copy(struct listing *l, const struct listing *src);
+int listing_remove_batch(struct listing *l, struct record **r, size_t n);
+struct index* listing_index(struct listing *l, int sort);
+int listing_match(struct listing *l, int sort, struct index *src,
+                  struct index *dest, const struct match *m);
 
 int library_init(struct library *li);
 void library_clear(struct library *li);
 
-struct record* get_record(char *line);
+struct record* store_record(struct listing *storage, struct record *r);
+struct record* get_record(struct listing *storage, char *line);
+struct record* lookup_record(struct listing *l, char *line);
 
 int library_import(struct library *lib, const char *scan, const char *path);
-int library_rescan(struct library *l, struct crate *c);
+int library_rescan(struct library *l, struct crate *c, bool full);
 
 #endif
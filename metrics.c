@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Local socket which gives a snapshot of the running program
+ *
+ * Each connection is sent a single JSON object and closed, eg.
+ *
+ *   socat - UNIX-CONNECT:/tmp/xwax.sock
+ *
+ * Counters are totals since startup, so a collector which connects
+ * at intervals can calculate rates. Nothing here is done in the
+ * realtime thread; its counters are read without locks.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "device.h"
+#include "metrics.h"
+#include "player.h"
+#include "rig.h"
+#include "selector.h"
+#include "timecoder.h"
+#include "track.h"
+#include "xwax.h"
+
+static const char *pathname;
+static struct library *library;
+static int listener, event[2];
+static pthread_t ph;
+static double started;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char* boolean(bool b)
+{
+    return b ? "true" : "false";
+}
+
+/*
+ * Write the state of a deck
+ *
+ * Pre: rig lock is held
+ */
+
+static void write_deck(FILE *f, struct deck *d)
+{
+    struct player *pl;
+    struct track *tr;
+    struct timecoder_stats tc;
+    struct device_stats dv;
+
+    pl = &d->player;
+    tr = pl->track;
+
+    timecoder_get_stats(&d->timecoder, &tc);
+    device_get_stats(&d->device, &dv);
+
+    fprintf(f, "{\"position\":%.3f,\"elapsed\":%.3f,\"pitch\":%.4f,"
+            "\"timecode_control\":%s,",
+            player_get_position(pl), player_get_elapsed(pl), pl->pitch,
+            boolean(pl->timecode_control));
+
+    fprintf(f, "\"timecode\":{\"samples\":%lu,\"locked\":%lu,"
+            "\"bits\":%lu,\"errors\":%lu,\"reversals\":%lu,"
+            "\"since_valid\":%.3f,\"level\":%.3f},",
+            tc.samples, tc.locked, tc.bits, tc.errors, tc.reversals,
+            (tc.samples - tc.last_valid) * d->timecoder.dt, tc.level);
+
+    fprintf(f, "\"device\":{\"fault\":%s,\"cycles\":%lu,\"xruns\":%lu,"
+            "\"busy\":%.6f,\"worst\":%.6f},",
+            boolean(d->device.fault), dv.cycles, dv.xruns,
+            dv.busy, dv.worst);
+
+    fprintf(f, "\"track\":{\"importing\":%s,\"bytes\":%zu,"
+            "\"seconds\":%.3f}}",
+            boolean(track_is_importing(tr)), tr->bytes,
+            (double)tr->length / tr->rate);
+}
+
+/*
+ * Write the snapshot of the whole program
+ *
+ * Pre: rig lock is held
+ */
+
+static void write_snapshot(FILE *f)
+{
+    size_t n;
+    struct track_stats tr;
+    struct selector_stats sel;
+
+    track_get_stats(&tr);
+    selector_get_stats(&sel);
+
+    fprintf(f, "{\"uptime\":%.3f,\"decks\":[", now() - started);
+
+    for (n = 0; n < ndeck; n++) {
+        if (n > 0)
+            fputc(',', f);
+        write_deck(f, &deck[n]);
+    }
+
+    fprintf(f, "],\"tracks\":{\"count\":%u,\"importing\":%u,"
+            "\"memory\":%zu,\"imported\":%llu,\"imports\":%llu},",
+            tr.tracks, tr.importing, tr.memory, tr.imported, tr.imports);
+
+    fprintf(f, "\"library\":{\"records\":%zu,\"crates\":%zu},",
+            library->storage.by_order.entries, library->crates);
+
+    fprintf(f, "\"search\":{\"searches\":%lu,\"seconds\":%.6f,"
+            "\"slowest\":%.6f}}\n",
+            sel.searches, sel.searching, sel.slowest);
+}
+
+/*
+ * Send a snapshot to a new connection, and close it
+ *
+ * The snapshot is small enough for the socket buffer; a client which
+ * is not reading does not hold up this thread, it is just cut short.
+ */
+
+static void serve(int fd)
+{
+    char *buf;
+    size_t len;
+    FILE *f;
+
+    f = open_memstream(&buf, &len);
+    if (f == NULL) {
+        perror("open_memstream");
+        goto out;
+    }
+
+    rig_lock();
+    write_snapshot(f);
+    rig_unlock();
+
+    if (fclose(f) == EOF) {
+        perror("fclose");
+        goto out;
+    }
+
+    if (send(fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL) == -1)
+        perror("send");
+
+    free(buf);
+out:
+    if (close(fd) == -1)
+        abort();
+}
+
+static void* launch(void *p)
+{
+    struct pollfd pt[2];
+
+    pt[0].fd = event[0];
+    pt[0].events = POLLIN;
+    pt[1].fd = listener;
+    pt[1].events = POLLIN;
+
+    for (;;) {
+        int fd;
+
+        if (poll(pt, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+
+        if (pt[0].revents != 0) /* asked to finish */
+            break;
+
+        if (pt[1].revents == 0)
+            continue;
+
+        fd = accept(listener, NULL, NULL);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            continue;
+        }
+
+        serve(fd);
+    }
+
+    return NULL;
+}
+
+/*
+ * Listen on a Unix socket at the given path
+ *
+ * Return: file descriptor, or -1 on error
+ */
+
+static int listen_on(const char *path)
+{
+    int fd;
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Socket path '%s' is too long.\n", path);
+        return -1;
+    }
+
+    /* Replace a socket left from a previous run, but nothing else */
+
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        if (unlink(path) == -1) {
+            perror(path);
+            return -1;
+        }
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd == -1) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof addr) == -1) {
+        perror(path);
+        goto fail;
+    }
+
+    if (listen(fd, 4) == -1) {
+        perror("listen");
+        goto fail;
+    }
+
+    return fd;
+
+fail:
+    if (close(fd) == -1)
+        abort();
+    return -1;
+}
+
+/*
+ * Start serving snapshots on a local socket at the given path
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+int metrics_start(const char *path, struct library *lib)
+{
+    int r;
+
+    pathname = path;
+    library = lib;
+    started = now();
+
+    listener = listen_on(path);
+    if (listener == -1)
+        return -1;
+
+    if (pipe(event) == -1) {
+        perror("pipe");
+        goto fail_listener;
+    }
+
+    fprintf(stderr, "Serving metrics on '%s'...\n", path);
+
+    r = pthread_create(&ph, NULL, launch, NULL);
+    if (r != 0) {
+        errno = r;
+        perror("pthread_create");
+        goto fail_pipe;
+    }
+
+    return 0;
+
+fail_pipe:
+    if (close(event[1]) == -1)
+        abort();
+    if (close(event[0]) == -1)
+        abort();
+fail_listener:
+    if (close(listener) == -1)
+        abort();
+    if (unlink(path) == -1)
+        perror(path);
+    return -1;
+}
+
+/*
+ * Stop serving snapshots, and remove the socket
+ */
+
+void metrics_stop(void)
+{
+    char e = 0;
+
+    if (write(event[1], &e, 1) == -1)
+        abort();
+
+    if (pthread_join(ph, NULL) != 0)
+        abort();
+
+    if (close(event[1]) == -1)
+        abort();
+    if (close(event[0]) == -1)
+        abort();
+    if (close(listener) == -1)
+        abort();
+
+    if (unlink(pathname) == -1)
+        perror(pathname);
+}
@@ -29,6 +29,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "lfsr.h"
+
 #define BANNER "xwax timecode generator " \
     "(C) Copyright 2026 Mark Hills <mark@xwax.org>"
 
@@ -40,41 +42,6 @@
 
 #define MAX(x,y) ((x)>(y)?(x):(y))
 
-typedef unsigned int bits_t;
-
-/*
- * Calculate the next bit in the LFSR sequence
- */
-
-static inline bits_t lfsr(bits_t code, bits_t taps)
-{
-    bits_t taken;
-    int xrs;
-
-    taken = code & taps;
-    xrs = 0;
-    while (taken != 0x0) {
-        xrs += taken & 0x1;
-        taken >>= 1;
-    }
-
-    return xrs & 0x1;
-}
-
-/*
- * LFSR in the forward direction
- */
-
-static inline bits_t fwd(bits_t current, bits_t taps, unsigned int nbits)
-{
-    bits_t l;
-
-    /* New bits are added at the MSB; shift right by one */
-
-    l = lfsr(current, taps | 0x1);
-    return (current >> 1) | (l << (nbits - 1));
-}
-
 static inline double dither(void)
 {
     return (double)(rand() % 32768) / 32768.0 - 0.5;
@@ -122,7 +89,7 @@ int main(int argc, char *argv[])
 
         if ((int)cycle > length) {
             assert((int)cycle - length == 1);
-            b = fwd(b, TAPS, BITS);
+            b = lfsr_fwd(b, TAPS, BITS);
             if (b == SEED) /* LFSR period reached */
                 break;
             length = cycle;
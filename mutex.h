@@ -66,6 +66,29 @@ static inline void mutex_lock(mutex *m)
         abort();
 }
 
+/*
+ * Take a mutex lock, only if it is not held elsewhere
+ *
+ * Pre: lock is initialised
+ * Pre: lock is not held by this thread
+ * Return: true if the lock is now held by this thread
+ */
+
+static inline bool mutex_trylock(mutex *m)
+{
+    int r;
+
+    rt_not_allowed();
+
+    r = pthread_mutex_trylock(m);
+    if (r == EBUSY)
+        return false;
+    if (r != 0)
+        abort();
+
+    return true;
+}
+
 /*
  * Release a mutex lock
  *
@@ -20,33 +20,61 @@
 #ifndef PITCH_H
 #define PITCH_H
 
-/* Values for the filter concluded experimentally */
+#include <math.h>
+
+#define PITCH_ALPHA_BETA 0
+#define PITCH_KALMAN 1
+
+/* Values for the alpha-beta filter concluded experimentally */
 
 #define ALPHA (1.0/512)
 #define BETA (ALPHA/256)
 
+/* Values for the Kalman filter, also concluded experimentally using
+ * the timecoder benchmark. Process noise is the variance of the
+ * acceleration, per second, and adapts between the given limits. */
+
+#define KALMAN_Q_MIN 1e-3
+#define KALMAN_Q_MAX 1e4
+#define KALMAN_Q_GROW 2.0
+#define KALMAN_Q_DECAY 0.98
+#define KALMAN_NIS 9.0 /* innovation considered to be a manoeuvre */
+#define KALMAN_ERROR 0.1 /* timing error, relative to one step */
+#define KALMAN_BOUND 1.5 /* overdue crossing, relative to one step */
+
 /* State of the pitch calculation filter */
 
 struct pitch {
+    int filter;
     double dt, x, v;
+
+    /* Kalman filter only */
+
+    double p00, p01, p11, /* covariance of x and v */
+        q, /* process noise, adapted to the observed acceleration */
+        step; /* magnitude of the last movement observed */
 };
 
 /* Prepare the filter for observations every dt seconds */
 
-static inline void pitch_init(struct pitch *p, double dt)
+static inline void pitch_init(struct pitch *p, double dt, int filter)
 {
+    p->filter = filter;
     p->dt = dt;
     p->x = 0.0;
     p->v = 0.0;
+
+    p->p00 = 0.0;
+    p->p01 = 0.0;
+    p->p11 = 1.0;
+    p->q = KALMAN_Q_MAX;
+    p->step = INFINITY;
 }
 
-/* Input an observation to the filter; in the last dt seconds the
- * position has moved by dx.
- *
- * Because the vinyl uses timestamps, the values for dx are discrete
- * rather than smooth. */
+/* Alpha-beta filter, with fixed gains. The position is sampled at
+ * the end of each dt. */
 
-static inline void pitch_dt_observation(struct pitch *p, double dx)
+static inline void alpha_beta_observation(struct pitch *p, double dx)
 {
     double predicted_x, predicted_v, residual_x;
 
@@ -61,6 +89,92 @@ static inline void pitch_dt_observation(struct pitch *p, double dx)
     p->x -= dx; /* relative to previous */
 }
 
+/* Kalman update of position x and velocity v, given a measurement of
+ * the position taken 'ago' seconds before the end of this dt */
+
+static inline double kalman_update(struct pitch *p, double z, double ago,
+                                   double r)
+{
+    double residual, s, k0, k1, ph0, ph1;
+
+    residual = z - (p->x - p->v * ago);
+
+    ph0 = p->p00 - p->p01 * ago;
+    ph1 = p->p01 - p->p11 * ago;
+    s = ph0 - ph1 * ago + r;
+
+    k0 = ph0 / s;
+    k1 = ph1 / s;
+
+    p->x += k0 * residual;
+    p->v += k1 * residual;
+
+    p->p00 -= k0 * ph0;
+    p->p01 -= k0 * ph1;
+    p->p11 -= k1 * ph1;
+
+    return residual * residual / s;
+}
+
+/* Kalman filter with a gain which adapts to the acceleration. A
+ * crossing is a precise measurement of the position, and no crossing
+ * is a bound on the position. */
+
+static inline void kalman_observation(struct pitch *p, double dx,
+                                      double ago)
+{
+    double dt, q, nis;
+
+    /* Predict */
+
+    dt = p->dt;
+    q = p->q;
+
+    p->x += p->v * dt;
+    p->p00 += dt * (2 * p->p01 + dt * p->p11) + q * dt * dt * dt / 3;
+    p->p01 += dt * p->p11 + q * dt * dt / 2;
+    p->p11 += q * dt;
+
+    if (dx != 0.0) {
+        p->step = fabs(dx);
+        nis = kalman_update(p, dx, ago, p->step * p->step
+                            * KALMAN_ERROR * KALMAN_ERROR);
+
+        /* Respond quickly when the record is pushed, settle slowly
+         * when it is stable */
+
+        if (nis > KALMAN_NIS)
+            p->q = fmin(p->q * KALMAN_Q_GROW, KALMAN_Q_MAX);
+        else
+            p->q = fmax(p->q * KALMAN_Q_DECAY, KALMAN_Q_MIN);
+
+        p->x -= dx; /* relative to previous */
+
+    } else if (fabs(p->x) > p->step * KALMAN_BOUND) {
+
+        /* The record has not reached the next crossing; it can be no
+         * further than this */
+
+        kalman_update(p, copysign(p->step * KALMAN_BOUND, p->x), 0.0,
+                      p->step * p->step);
+    }
+}
+
+/* Input an observation to the filter; in the last dt seconds the
+ * position has moved by dx, 'ago' seconds before the end of dt.
+ *
+ * Because the vinyl uses timestamps, the values for dx are discrete
+ * rather than smooth. */
+
+static inline void pitch_dt_observation(struct pitch *p, double dx,
+                                        double ago)
+{
+    if (p->filter == PITCH_KALMAN)
+        kalman_observation(p, dx, ago);
+    else
+        alpha_beta_observation(p, dx);
+}
+
 /* Get the pitch after filtering */
 
 static inline double pitch_current(struct pitch *p)
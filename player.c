@@ -29,6 +29,7 @@
 #include "player.h"
 #include "track.h"
 #include "timecoder.h"
+#include "trace.h"
 
 /* Bend playback speed to compensate for the difference between our
  * current position and that given by the timecode */
@@ -438,6 +439,8 @@ void player_collect(struct player *pl, signed short *pcm, unsigned samples)
 {
     double r, pitch, dt, target_volume;
 
+    trace_begin("player_collect");
+
     dt = pl->sample_dt * samples;
 
     if (pl->timecode_control) {
@@ -483,4 +486,6 @@ void player_collect(struct player *pl, signed short *pcm, unsigned samples)
 
     pl->position += r;
     pl->volume = target_volume;
+
+    trace_end("player_collect");
 }
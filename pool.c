@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * Pool of worker threads, to divide up large pieces of work across
+ * the idle cores of the machine
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "trace.h"
+
+#define MAX_WORKERS (POOL_MAX - 1)
+
+static pthread_t worker[MAX_WORKERS];
+static unsigned int workers;
+
+static pthread_mutex_t busy = PTHREAD_MUTEX_INITIALIZER, /* one job */
+    lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER,
+    done = PTHREAD_COND_INITIALIZER;
+
+/* The current job, protected by the lock */
+
+static void (*job_fn)(void *arg, unsigned int part);
+static void *job_arg;
+static unsigned int job_parts, job_next, job_finished;
+static unsigned long generation;
+static bool quit;
+
+/*
+ * Take parts of the current job until there are none left
+ *
+ * Pre: lock is held
+ */
+
+static void take_parts(void)
+{
+    void (*fn)(void *arg, unsigned int part);
+    void *arg;
+
+    fn = job_fn;
+    arg = job_arg;
+
+    while (job_next < job_parts) {
+        unsigned int part;
+
+        part = job_next++;
+
+        pthread_mutex_unlock(&lock);
+        fn(arg, part);
+        pthread_mutex_lock(&lock);
+
+        if (++job_finished == job_parts)
+            pthread_cond_signal(&done);
+    }
+}
+
+static void* launch(void *p)
+{
+    unsigned long seen;
+
+    trace_thread("pool");
+
+    seen = 0;
+    pthread_mutex_lock(&lock);
+
+    for (;;) {
+        while (!quit && generation == seen)
+            pthread_cond_wait(&wake, &lock);
+
+        if (quit)
+            break;
+
+        seen = generation;
+        take_parts();
+    }
+
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+/*
+ * Start the workers, to give the given number of threads including
+ * the caller, or zero for one thread per core
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+int pool_global_init(unsigned int threads)
+{
+    if (threads == 0) {
+        long cores;
+
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cores > 0) ? cores : 1;
+    }
+
+    quit = false;
+
+    for (workers = 0; workers < threads - 1 && workers < MAX_WORKERS;
+         workers++)
+    {
+        int r;
+
+        r = pthread_create(&worker[workers], NULL, launch, NULL);
+        if (r != 0) {
+            errno = r;
+            perror("pthread_create");
+            pool_global_clear();
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void pool_global_clear(void)
+{
+    unsigned int n;
+
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    for (n = 0; n < workers; n++) {
+        if (pthread_join(worker[n], NULL) != 0)
+            abort();
+    }
+
+    workers = 0;
+}
+
+/*
+ * Return: the number of threads which can run a job at once
+ */
+
+unsigned int pool_threads(void)
+{
+    return workers + 1;
+}
+
+/*
+ * Run the given function for each part of a job, and return when
+ * they are all complete
+ *
+ * The caller takes parts too. If the pool is not running, or is
+ * busy with another job, all parts are run by the caller.
+ */
+
+void pool_run(void (*fn)(void *arg, unsigned int part), void *arg,
+              unsigned int parts)
+{
+    unsigned int n;
+
+    if (workers == 0 || parts < 2 || pthread_mutex_trylock(&busy) != 0) {
+        for (n = 0; n < parts; n++)
+            fn(arg, n);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    job_fn = fn;
+    job_arg = arg;
+    job_parts = parts;
+    job_next = 0;
+    job_finished = 0;
+    generation++;
+    pthread_cond_broadcast(&wake);
+
+    take_parts();
+
+    while (job_finished < job_parts)
+        pthread_cond_wait(&done, &lock);
+
+    pthread_mutex_unlock(&lock);
+    pthread_mutex_unlock(&busy);
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#define POOL_MAX 8 /* threads, including the caller */
+
+int pool_global_init(unsigned int threads);
+void pool_global_clear(void);
+
+unsigned int pool_threads(void);
+void pool_run(void (*fn)(void *arg, unsigned int part), void *arg,
+              unsigned int parts);
+
+#endif
@@ -27,6 +27,7 @@
 #include "device.h"
 #include "realtime.h"
 #include "thread.h"
+#include "trace.h"
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
 
@@ -73,6 +74,7 @@ static void rt_main(struct rt *rt)
     debug("%p", rt);
 
     thread_to_realtime();
+    trace_thread("realtime");
 
     if (rt->priority != 0) {
         if (raise_priority(rt->priority) == -1)
@@ -93,11 +95,15 @@ static void rt_main(struct rt *rt)
             }
         }
 
+        trace_begin("rt_main");
+
         for (n = 0; n < rt->nctl; n++)
             controller_handle(rt->ctl[n]);
 
         for (n = 0; n < rt->ndv; n++)
             device_handle(rt->dv[n]);
+
+        trace_end("rt_main");
     }
 }
 
@@ -21,15 +21,18 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "list.h"
 #include "mutex.h"
 #include "realtime.h"
 #include "rig.h"
+#include "trace.h"
 
 #define EVENT_WAKE 0
 #define EVENT_QUIT 1
@@ -37,10 +40,51 @@
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
 
 static int event[2]; /* pipe to wake up service thread */
+static volatile sig_atomic_t quit; /* in case the pipe was full */
 static struct list tracks = LIST_INIT(tracks),
     excrates = LIST_INIT(excrates);
 mutex lock;
 
+/* Use of the lock; protected by the lock itself */
+
+static struct rig_stats stats;
+static double taken;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Take the lock, and account for the time spent waiting for it
+ */
+
+static void take(void)
+{
+    if (!mutex_trylock(&lock)) {
+        double start;
+
+        start = now();
+        mutex_lock(&lock);
+        stats.waited += now() - start;
+        stats.contended++;
+    }
+
+    stats.taken++;
+    taken = now();
+}
+
+static void give(void)
+{
+    stats.held += now() - taken;
+    mutex_unlock(&lock);
+}
+
 int rig_init()
 {
     /* Create a pipe which will be used to wake us from other threads */
@@ -50,7 +94,9 @@ int rig_init()
         return -1;
     }
 
-    if (fcntl(event[0], F_SETFL, O_NONBLOCK) == -1) {
+    if (fcntl(event[0], F_SETFL, O_NONBLOCK) == -1
+        || fcntl(event[1], F_SETFL, O_NONBLOCK) == -1)
+    {
         perror("fcntl");
         if (close(event[1]) == -1)
             abort();
@@ -98,7 +144,8 @@ int rig_main()
     pt[0].revents = 0;
     pt[0].events = POLLIN;
 
-    mutex_lock(&lock);
+    trace_thread("rig");
+    take();
 
     for (;;) { /* exit via EVENT_QUIT */
         int r;
@@ -124,12 +171,12 @@ int rig_main()
             pe++;
         }
 
-        mutex_unlock(&lock);
+        give();
 
         r = poll(pt, pe - pt, -1);
         if (r == -1) {
             if (errno == EINTR) {
-                mutex_lock(&lock);
+                take();
                 continue;
             } else {
                 perror("poll");
@@ -165,30 +212,39 @@ int rig_main()
                     abort();
                 }
             }
+
+            if (quit)
+                goto finish;
         }
 
-        mutex_lock(&lock);
+        take();
+        trace_begin("rig_main");
 
         list_for_each_safe(track, xtrack, &tracks, rig)
             track_handle(track);
 
         list_for_each_safe(excrate, xexcrate, &excrates, rig)
             excrate_handle(excrate);
+
+        trace_end("rig_main");
     }
  finish:
+    quit = 0;
 
     return 0;
 }
 
 /*
- * Post a simple event into the rig event loop
+ * Post a simple event into the rig event loop, without blocking
+ *
+ * A full pipe is as good as posted; the rig is sure to wake.
  */
 
 static int post_event(char e)
 {
-    rt_not_allowed();
-
     if (write(event[1], &e, 1) == -1) {
+        if (errno == EAGAIN)
+            return 0;
         perror("write");
         return -1;
     }
@@ -197,22 +253,40 @@ static int post_event(char e)
 }
 
 /*
- * Ask the rig to exit from another thread or signal handler
+ * Ask the rig to exit from another thread, including the realtime
+ * thread, or signal handler
  */
 
 int rig_quit()
 {
+    quit = 1; /* the event itself may not fit in the pipe */
     return post_event(EVENT_QUIT);
 }
 
 void rig_lock(void)
 {
-    mutex_lock(&lock);
+    take();
 }
 
 void rig_unlock(void)
 {
-    mutex_unlock(&lock);
+    give();
+}
+
+/*
+ * Get the use of the lock since the last call
+ *
+ * Pre: lock is held
+ */
+
+void rig_stats(struct rig_stats *s)
+{
+    *s = stats;
+
+    stats.taken = 0;
+    stats.contended = 0;
+    stats.waited = 0.0;
+    stats.held = 0.0;
 }
 
 /*
@@ -221,6 +295,8 @@ void rig_unlock(void)
 
 void rig_post_track(struct track *t)
 {
+    rt_not_allowed();
+
     track_acquire(t);
     list_add(&t->rig, &tracks);
     post_event(EVENT_WAKE);
@@ -228,6 +304,8 @@ void rig_post_track(struct track *t)
 
 void rig_post_excrate(struct excrate *e)
 {
+    rt_not_allowed();
+
     excrate_acquire(e);
     list_add(&e->rig, &excrates);
     post_event(EVENT_WAKE);
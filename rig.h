@@ -23,6 +23,13 @@
 #include "excrate.h"
 #include "track.h"
 
+/* Use of the lock, which is taken by the rig and the interface */
+
+struct rig_stats {
+    unsigned long taken, contended;
+    double waited, held; /* seconds */
+};
+
 int rig_init();
 void rig_clear();
 
@@ -32,6 +39,7 @@ int rig_quit();
 
 void rig_lock();
 void rig_unlock();
+void rig_stats(struct rig_stats *s);
 
 void rig_post_track(struct track *t);
 void rig_post_excrate(struct excrate *e);
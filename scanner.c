@@ -0,0 +1,752 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Built-in scanner of a music library
+ *
+ * An equivalent of the default scan script, which runs in a thread
+ * of its own rather than a pipeline of processes. The output is the
+ * same, and is given to the caller through a socket, to read as it
+ * would from the script.
+ */
+
+#define _GNU_SOURCE /* getline(), MSG_NOSIGNAL */
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scanner.h"
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+#define DEPTH 64 /* of directories, to detect loops */
+
+struct scanner {
+    pthread_t thread;
+    int fd; /* our end of the socket */
+    const char *path, *manifest;
+    int cancel; /* accessed atomically */
+
+    /* Output to the socket */
+
+    char buf[65536];
+    size_t len;
+    bool broken;
+};
+
+/* Files of interest to the scan */
+
+static const char *extension[] = {
+    "ogg", "oga", "aac", "cdaudio", "mp3", "flac", "wav",
+    "aif", "aiff", "m4a", "wma"
+};
+
+/*
+ * The rules of the scan script, for the artist and title from the
+ * pathname, then the BPM from the end of the title; see the script
+ * for the patterns which they recognise. The pattern numbers give
+ * the artist and title in the matched subexpressions, or zero for
+ * none.
+ *
+ * The script matches without regard to case; here the patterns
+ * spell it out, which is much quicker to match. Also, each pattern
+ * can only match the last few components of the pathname, and some
+ * need a hyphen; this saves most of the work of matching.
+ */
+
+#define NUMBER "[A-Ha-h]?[Aa0-9]?[0-9].? +" /* eg. "A1. " or "01 " */
+
+static const struct rule {
+    const char *pattern;
+    unsigned int artist, title,
+        components; /* at most, at the end of the pathname */
+    bool hyphen;
+} rules[] = {
+    { "/(" NUMBER ")?([^/]*) +- +([^/]*)\\.[A-Za-z0-9]*$",
+      2, 3, 1, true },
+    { "/([^/]*) +- +([^/]*)(/([Dd][Ii][Ss][Cc]|[Ss][Ii][Dd][Ee]) "
+      "[0-9A-Za-z][^/]*)?/(" NUMBER ")?([^/]*)\\.[A-Za-z0-9]*$",
+      1, 6, 3, true },
+    { "/(" NUMBER ")?([^/]*)\\.[A-Za-z0-9]*$", 0, 2, 1, false },
+};
+
+static const char *bpm_pattern = "^(.*) *\\(([0-9]+\\.?[0-9]+) *BPM\\)$";
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static regex_t rule_regex[ARRAY_SIZE(rules)], bpm_regex;
+static bool compiled;
+
+/*
+ * Compile the rules, once for all scans
+ */
+
+static void compile(void)
+{
+    size_t n;
+
+    for (n = 0; n < ARRAY_SIZE(rules); n++) {
+        if (regcomp(&rule_regex[n], rules[n].pattern, REG_EXTENDED) != 0)
+            return;
+    }
+
+    if (regcomp(&bpm_regex, bpm_pattern, REG_EXTENDED) != 0)
+        return;
+
+    compiled = true;
+}
+
+static bool cancelled(struct scanner *s)
+{
+    return __sync_fetch_and_add(&s->cancel, 0) != 0;
+}
+
+/*
+ * Send the buffered output
+ *
+ * Return: 0 on success, or -1 if the reader has gone
+ */
+
+static int flush(struct scanner *s)
+{
+    size_t done;
+
+    for (done = 0; done < s->len; ) {
+        ssize_t z;
+
+        z = send(s->fd, s->buf + done, s->len - done, MSG_NOSIGNAL);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            s->broken = true;
+            return -1;
+        }
+
+        done += z;
+    }
+
+    s->len = 0;
+    return 0;
+}
+
+/*
+ * Append text to the output
+ *
+ * Return: 0 on success, or -1 if the reader has gone
+ */
+
+static int put(struct scanner *s, const char *text, size_t len)
+{
+    while (len > 0) {
+        size_t z;
+
+        if (s->len == sizeof s->buf) {
+            if (flush(s) == -1)
+                return -1;
+        }
+
+        z = sizeof s->buf - s->len;
+        if (z > len)
+            z = len;
+
+        memcpy(s->buf + s->len, text, z);
+        s->len += z;
+        text += z;
+        len -= z;
+    }
+
+    return 0;
+}
+
+static int put_match(struct scanner *s, const char *line,
+                     const regmatch_t *m)
+{
+    if (m->rm_so == -1)
+        return 0;
+
+    return put(s, line + m->rm_so, m->rm_eo - m->rm_so);
+}
+
+/*
+ * Return: the last n components of the pathname, including the
+ * leading slash
+ */
+
+static const char* last(const char *pathname, unsigned int n)
+{
+    const char *x;
+
+    x = pathname + strlen(pathname);
+
+    while (x > pathname) {
+        x--;
+        if (*x == '/' && --n == 0)
+            break;
+    }
+
+    return x;
+}
+
+/*
+ * Output the record for the given pathname, if it is recognised by
+ * the rules
+ *
+ * Return: 0 on success, or -1 if the reader has gone
+ */
+
+static int output(struct scanner *s, const char *prefix,
+                  const char *pathname)
+{
+    size_t n, len;
+    regmatch_t m[8], b[3];
+    const struct rule *r;
+    const char *x;
+    char *title;
+
+    for (n = 0; n < ARRAY_SIZE(rules); n++) {
+        r = &rules[n];
+        x = last(pathname, r->components);
+
+        if (r->hyphen && strstr(x, " - ") == NULL)
+            continue;
+
+        if (regexec(&rule_regex[n], x, ARRAY_SIZE(m), m, 0) == 0)
+            break;
+    }
+
+    if (n == ARRAY_SIZE(rules))
+        return 0;
+
+    if (put(s, prefix, strlen(prefix)) == -1)
+        return -1;
+    if (put(s, pathname, strlen(pathname)) == -1 || put(s, "\t", 1) == -1)
+        return -1;
+    if (r->artist && put_match(s, x, &m[r->artist]) == -1)
+        return -1;
+    if (put(s, "\t", 1) == -1)
+        return -1;
+
+    /* The BPM is taken from the end of the title, which is the end
+     * of the line from the script */
+
+    title = strndup(x + m[r->title].rm_so, m[r->title].rm_eo - m[r->title].rm_so);
+    if (title == NULL) {
+        perror("strndup");
+        return -1;
+    }
+
+    len = strlen(title);
+
+    if (len > 4 && strcmp(title + len - 4, "BPM)") == 0
+        && regexec(&bpm_regex, title, ARRAY_SIZE(b), b, 0) == 0)
+    {
+        if (put_match(s, title, &b[1]) == -1 || put(s, "\t", 1) == -1
+            || put_match(s, title, &b[2]) == -1)
+        {
+            goto fail;
+        }
+    } else {
+        if (put(s, title, len) == -1)
+            goto fail;
+    }
+
+    free(title);
+    return put(s, "\n", 1);
+
+fail:
+    free(title);
+    return -1;
+}
+
+/*
+ * Return: true if the filename is one of the types of interest
+ */
+
+static bool is_audio(const char *name)
+{
+    const char *x;
+    size_t n;
+
+    x = strrchr(name, '.');
+    if (x == NULL)
+        return false;
+
+    for (n = 0; n < ARRAY_SIZE(extension); n++) {
+        if (strcasecmp(x + 1, extension[n]) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/* A list of pathnames, to compare against the manifest */
+
+struct paths {
+    char **path;
+    size_t size, entries;
+};
+
+static void paths_init(struct paths *l)
+{
+    l->path = NULL;
+    l->size = 0;
+    l->entries = 0;
+}
+
+static void paths_clear(struct paths *l)
+{
+    size_t n;
+
+    for (n = 0; n < l->entries; n++)
+        free(l->path[n]);
+    free(l->path);
+}
+
+static int paths_add(struct paths *l, const char *pathname)
+{
+    char *p;
+
+    if (l->entries == l->size) {
+        char **x;
+        size_t size;
+
+        size = l->size ? l->size * 2 : 1024;
+        x = realloc(l->path, sizeof *x * size);
+        if (x == NULL) {
+            perror("realloc");
+            return -1;
+        }
+
+        l->path = x;
+        l->size = size;
+    }
+
+    p = strdup(pathname);
+    if (p == NULL) {
+        perror("strdup");
+        return -1;
+    }
+
+    l->path[l->entries++] = p;
+    return 0;
+}
+
+/*
+ * Take a file which is found by the scan; either output it
+ * directly, or keep it to compare against the manifest
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int found(struct scanner *s, struct paths *l, const char *pathname)
+{
+    if (l != NULL)
+        return paths_add(l, pathname);
+    else
+        return output(s, "", pathname);
+}
+
+struct ancestor {
+    dev_t dev;
+    ino_t ino;
+};
+
+/*
+ * Walk the directory, following symbolic links as "find -L"
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int walk(struct scanner *s, struct paths *l, char *path, size_t len,
+                struct ancestor *a, unsigned int depth)
+{
+    DIR *d;
+    struct dirent *e;
+    struct stat st;
+    unsigned int n;
+    int r;
+
+    d = opendir(path);
+    if (d == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    if (fstat(dirfd(d), &st) == -1) {
+        perror("fstat");
+        closedir(d);
+        return -1;
+    }
+
+    for (n = 0; n < depth; n++) {
+        if (a[n].dev == st.st_dev && a[n].ino == st.st_ino) {
+            fprintf(stderr, "%s: File system loop detected\n", path);
+            closedir(d);
+            return -1;
+        }
+    }
+
+    if (depth == DEPTH) {
+        fprintf(stderr, "%s: Too deep\n", path);
+        closedir(d);
+        return -1;
+    }
+
+    a[depth].dev = st.st_dev;
+    a[depth].ino = st.st_ino;
+
+    r = 0;
+
+    while ((e = readdir(d)) != NULL) {
+        size_t z;
+        unsigned char type;
+
+        if (cancelled(s) || s->broken) {
+            r = -1;
+            break;
+        }
+
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+            continue;
+
+        z = strlen(e->d_name);
+        if (len + z + 2 > PATH_MAX) {
+            fprintf(stderr, "%s/%s: Pathname too long\n", path, e->d_name);
+            r = -1;
+            continue;
+        }
+
+        path[len] = '/';
+        memcpy(path + len + 1, e->d_name, z + 1);
+
+        type = e->d_type;
+
+        if (type == DT_LNK || type == DT_UNKNOWN) {
+            if (stat(path, &st) == -1) {
+                if (errno != ENOENT) /* eg. dangling link */
+                    perror(path);
+                path[len] = '\0';
+                continue;
+            }
+
+            if (S_ISDIR(st.st_mode))
+                type = DT_DIR;
+            else if (S_ISREG(st.st_mode))
+                type = DT_REG;
+        }
+
+        if (type == DT_DIR) {
+            if (walk(s, l, path, len + z + 1, a, depth + 1) == -1)
+                r = -1;
+        } else if (type == DT_REG && is_audio(e->d_name)) {
+            if (found(s, l, path) == -1) {
+                r = -1;
+                path[len] = '\0';
+                break;
+            }
+        }
+
+        path[len] = '\0';
+    }
+
+    if (closedir(d) == -1)
+        abort();
+
+    return r;
+}
+
+/*
+ * Read pathnames from a file, one per line
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int read_lines(struct scanner *s, struct paths *l,
+                      const char *pathname)
+{
+    FILE *f;
+    char *line;
+    size_t size;
+    ssize_t z;
+    int r;
+
+    f = fopen(pathname, "r");
+    if (f == NULL) {
+        perror(pathname);
+        return -1;
+    }
+
+    line = NULL;
+    size = 0;
+    r = 0;
+
+    while ((z = getline(&line, &size, f)) != -1) {
+        if (z > 0 && line[z - 1] == '\n')
+            line[z - 1] = '\0';
+
+        if (s != NULL && (cancelled(s) || s->broken)) {
+            r = -1;
+            break;
+        }
+
+        if (s != NULL)
+            r = found(s, l, line);
+        else
+            r = paths_add(l, line);
+
+        if (r == -1)
+            break;
+    }
+
+    free(line);
+    fclose(f);
+
+    return r;
+}
+
+/*
+ * Comparison of pathnames, in the "C" collation of sort(1)
+ */
+
+static int qcompar(const void *a, const void *b)
+{
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+/*
+ * Output the differences between the manifest and the files found,
+ * as comm(1) would; first the files which have gone, then the new
+ * ones
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int compare(struct scanner *s, struct paths *before,
+                   struct paths *after)
+{
+    size_t x, y;
+    int pass;
+
+    qsort(before->path, before->entries, sizeof *before->path, qcompar);
+    qsort(after->path, after->entries, sizeof *after->path, qcompar);
+
+    for (pass = 0; pass < 2; pass++) {
+        x = 0;
+        y = 0;
+
+        while (x < before->entries || y < after->entries) {
+            int c;
+
+            if (x == before->entries)
+                c = 1;
+            else if (y == after->entries)
+                c = -1;
+            else
+                c = strcmp(before->path[x], after->path[y]);
+
+            if (c == 0) {
+                x++;
+                y++;
+                continue;
+            }
+
+            if (c < 0) {
+                if (pass == 0 && output(s, "-\t", before->path[x]) == -1)
+                    return -1;
+                x++;
+            } else {
+                if (pass == 1 && output(s, "", after->path[y]) == -1)
+                    return -1;
+                y++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Scan the path, as the scan script
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int scan(struct scanner *s)
+{
+    struct paths before, after, *l;
+    struct stat st;
+    int r;
+
+    paths_init(&before);
+    paths_init(&after);
+
+    l = NULL;
+    if (s->manifest != NULL) {
+        if (read_lines(NULL, &before, s->manifest) == -1)
+            goto fail;
+        l = &after;
+    }
+
+    if (stat(s->path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        char path[PATH_MAX];
+        struct ancestor a[DEPTH];
+        size_t len;
+
+        len = strlen(s->path);
+        if (len >= sizeof path) {
+            fprintf(stderr, "%s: Pathname too long\n", s->path);
+            goto fail;
+        }
+
+        memcpy(path, s->path, len + 1);
+        r = walk(s, l, path, len, a, 0);
+    } else {
+        r = read_lines(s, l, s->path); /* a playlist */
+    }
+
+    if (r == -1)
+        goto fail;
+
+    if (l != NULL && compare(s, &before, &after) == -1)
+        goto fail;
+
+    paths_clear(&before);
+    paths_clear(&after);
+
+    return flush(s);
+
+fail:
+    paths_clear(&before);
+    paths_clear(&after);
+    (void)flush(s);
+    return -1;
+}
+
+static void* launch(void *p)
+{
+    struct scanner *s = p;
+    int r;
+
+    r = scan(s);
+
+    if (close(s->fd) == -1)
+        abort();
+
+    return (void*)(intptr_t)r;
+}
+
+/*
+ * Start a scan of the given path, or only the changes since the
+ * given manifest; see the scan script
+ *
+ * Return: scanner, or NULL on error
+ * Post: on success, *fd is the file descriptor for reading
+ */
+
+struct scanner* scanner_start(const char *path, const char *manifest,
+                              int *fd)
+{
+    struct scanner *s;
+    int sv[2], r;
+
+    pthread_once(&once, compile);
+    if (!compiled) {
+        fprintf(stderr, "Scanner rules did not compile\n");
+        return NULL;
+    }
+
+    s = malloc(sizeof *s);
+    if (s == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        perror("socketpair");
+        goto fail;
+    }
+
+    if (fcntl(sv[0], F_SETFL, O_NONBLOCK) == -1) {
+        perror("fcntl");
+        goto fail_socket;
+    }
+
+    s->fd = sv[1];
+    s->path = path;
+    s->manifest = manifest;
+    s->cancel = 0;
+    s->len = 0;
+    s->broken = false;
+
+    r = pthread_create(&s->thread, NULL, launch, s);
+    if (r != 0) {
+        errno = r;
+        perror("pthread_create");
+        goto fail_socket;
+    }
+
+    *fd = sv[0];
+    return s;
+
+fail_socket:
+    if (close(sv[0]) == -1 || close(sv[1]) == -1)
+        abort();
+fail:
+    free(s);
+    return NULL;
+}
+
+/*
+ * Request that the scan stops early
+ */
+
+void scanner_cancel(struct scanner *s)
+{
+    (void)__sync_fetch_and_add(&s->cancel, 1);
+}
+
+/*
+ * Wait for the scan to finish, and free it
+ *
+ * Return: 0 if the scan was successful, otherwise -1
+ */
+
+int scanner_join(struct scanner *s)
+{
+    void *r;
+
+    if (pthread_join(s->thread, &r) != 0)
+        abort();
+
+    free(s);
+
+    return (intptr_t)r;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+/* Name given in place of a scan script to use the built-in scanner */
+
+#define SCANNER_BUILTIN "builtin"
+
+struct scanner;
+
+struct scanner* scanner_start(const char *path, const char *manifest,
+                              int *fd);
+void scanner_cancel(struct scanner *s);
+int scanner_join(struct scanner *s);
+
+#endif
@@ -18,10 +18,31 @@
  */
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "selector.h"
 
+#define BUDGET 4096 /* entries which may always be kept by the search */
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+/* Protected by the rig lock */
+
+static struct selector_stats stats;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 /*
  * Scroll to our target entry if it can be found, otherwise leave our
  * position unchanged
@@ -59,13 +80,13 @@ static void retain_target(struct selector *sel)
 
 /*
  * Optimised version of retain_target where our position may
- * only have moved due to insertion of a single record
+ * only have moved due to insertion of the given number of records
  */
 
-static void hunt_target(struct selector *s)
+static void hunt_target(struct selector *s, size_t inserted)
 {
     struct index *l;
-    size_t n;
+    size_t n, i;
 
     if (s->target == NULL)
         return;
@@ -73,16 +94,20 @@ static void hunt_target(struct selector *s)
     l = s->view_index;
     n = listbox_current(&s->records);
 
-    if (n < l->entries && l->record[n + 1] == s->target) {
+    for (i = 0; i <= inserted && n + i < l->entries; i++) {
         struct listbox *x;
 
+        if (l->record[n + i] != s->target)
+            continue;
+
         /* Retain selection in the same position on screen
          * FIXME: listbox should provide this functionality */
 
         x = &s->records;
 
-        x->selected++;
-        x->offset++;
+        x->selected += i;
+        x->offset += i;
+        break;
     }
 }
 
@@ -112,16 +137,7 @@ static struct index* initial(struct selector *sel)
     c = current_crate(sel);
     assert(c != NULL);
 
-    switch (sel->sort) {
-    case SORT_ARTIST:
-        return &c->listing->by_artist;
-    case SORT_BPM:
-        return &c->listing->by_bpm;
-    case SORT_PLAYLIST:
-        return &c->listing->by_order;
-    default:
-        abort();
-    }
+    return listing_index(c->listing, sel->sort);
 }
 
 static void notify(struct selector *s)
@@ -129,6 +145,111 @@ static void notify(struct selector *s)
     fire(&s->changed, NULL);
 }
 
+/*
+ * Discard the stored result for a search of the given length
+ */
+
+static void forget_level(struct selector *sel, size_t n)
+{
+    assert(n > 0);
+
+    if (!sel->stored[n])
+        return;
+
+    index_clear(&sel->level[n]);
+    index_init(&sel->level[n]);
+    sel->stored[n] = false;
+}
+
+static void forget_levels(struct selector *sel)
+{
+    size_t n;
+
+    for (n = 1; n < ARRAY_SIZE(sel->level); n++)
+        forget_level(sel, n);
+}
+
+/*
+ * Keep the stored results within a budget relative to the size of
+ * the crate, by discarding the largest which are not in view
+ */
+
+static void trim_levels(struct selector *sel)
+{
+    size_t budget;
+
+    budget = 2 * initial(sel)->entries + BUDGET;
+
+    for (;;) {
+        size_t n, total, largest;
+
+        total = 0;
+        largest = 0;
+
+        for (n = 1; n < ARRAY_SIZE(sel->level); n++) {
+            if (!sel->stored[n])
+                continue;
+
+            total += sel->level[n].size;
+
+            if (n == sel->search_len)
+                continue;
+            if (largest == 0 || sel->level[n].size > sel->level[largest].size)
+                largest = n;
+        }
+
+        if (total <= budget || largest == 0)
+            break;
+
+        forget_level(sel, largest);
+    }
+}
+
+/*
+ * Set the view to the result of the current search, working from
+ * the nearest shorter search which is stored
+ *
+ * Do not disrupt the running process on memory allocation failure,
+ * leave the view index incomplete
+ */
+
+static void update_view(struct selector *sel)
+{
+    size_t n, k;
+    double start, elapsed;
+
+    n = sel->search_len;
+
+    if (n == 0) {
+        sel->view_index = initial(sel);
+        return;
+    }
+
+    sel->view_index = &sel->level[n];
+    if (sel->stored[n])
+        return;
+
+    for (k = n - 1; k > 0; k--) {
+        if (sel->stored[k])
+            break;
+    }
+
+    start = now();
+
+    (void)listing_match(current_crate(sel)->listing, sel->sort,
+                        k > 0 ? &sel->level[k] : NULL,
+                        &sel->level[n], &sel->match);
+    sel->stored[n] = true;
+
+    elapsed = now() - start;
+    stats.searches++;
+    stats.searching += elapsed;
+    if (elapsed > stats.slowest)
+        stats.slowest = elapsed;
+
+    trim_levels(sel);
+}
+
 /*
  * When the crate has changed, update the current index to reflect
  * the crate and the search criteria
@@ -136,7 +257,8 @@ static void notify(struct selector *s)
 
 static void do_content_change(struct selector *sel)
 {
-    (void)index_match(initial(sel), sel->view_index, &sel->match);
+    forget_levels(sel);
+    update_view(sel);
     listbox_set_entries(&sel->records, sel->view_index->entries);
     retain_target(sel);
     notify(sel);
@@ -169,40 +291,102 @@ static void handle_refresh(struct observer *o, void *x)
 }
 
 /*
- * A new record has been added to the currently selected crate. Merge
- * this new addition into the current view, if applicable.
+ * New records have been added to the currently selected crate. Merge
+ * these new additions into the current view, if applicable.
  */
 
 static void merge_addition(struct observer *o, void *x)
 {
     struct selector *s = container_of(o, struct selector, on_addition);
-    struct record *r = x;
+    const struct additions *a = x;
+    struct record **matched;
+    size_t n, i, inserted;
+    bool found;
+
+    assert(a != NULL);
+    assert(a->entries > 0);
+
+    matched = malloc(sizeof *matched * a->entries);
+    if (matched == NULL) {
+        perror("malloc");
+        do_content_change(s); /* notifies */
+        return;
+    }
 
-    assert(r != NULL);
+    /* Level zero is the crate's own index, which already has the
+     * records; the others are the results of shorter searches */
 
-    if (!record_match(r, &s->match))
-        return;
+    for (n = 1; n <= s->search_len; n++) {
+        struct index *l;
+        const struct match *m;
+        struct match prefix;
+        size_t k;
 
-    /* If we're out of memory then silently drop it */
+        if (!s->stored[n])
+            continue;
 
-    if (index_reserve(s->view_index, 1) == -1)
-        return;
+        if (n == s->search_len) {
+            m = &s->match;
+        } else {
+            char buf[sizeof s->search];
 
-    if (s->sort == SORT_PLAYLIST)
-        index_add(s->view_index, r);
-    else
-        index_insert(s->view_index, r, s->sort);
+            memcpy(buf, s->search, n);
+            buf[n] = '\0';
+            match_compile(&prefix, buf);
+            m = &prefix;
+        }
+
+        k = 0;
+        for (i = 0; i < a->entries; i++) {
+            if (record_match(a->record[i], m))
+                matched[k++] = a->record[i];
+        }
+
+        if (k == 0)
+            continue;
+
+        /* If we're out of memory then silently drop them */
+
+        l = &s->level[n];
+
+        if (index_reserve(l, k) == -1)
+            continue;
+
+        if (s->sort == SORT_PLAYLIST) {
+            for (i = 0; i < k; i++)
+                index_add(l, matched[i]);
+        } else {
+            index_sort(matched, k, s->sort);
+            index_merge(l, matched, k, s->sort);
+        }
+    }
+
+    free(matched);
+
+    inserted = 0;
+    found = false;
+
+    for (i = 0; i < a->entries; i++) {
+        if (!record_match(a->record[i], &s->match))
+            continue;
+
+        inserted++;
+        if (a->record[i] == s->target)
+            found = true;
+    }
+
+    if (inserted == 0)
+        return;
 
     listbox_set_entries(&s->records, s->view_index->entries);
 
-    /* If this addition is what we've been looking for, send the
-     * cursor to it (not optimal, in some cases we know the position
-     * from the insert above.) Otherwise track the target one step */
+    /* If these additions include what we've been looking for, send
+     * the cursor to it. Otherwise track the target as it moves */
 
-    if (r == s->target)
+    if (found)
         retain_target(s);
     else
-        hunt_target(s);
+        hunt_target(s, inserted);
 
     notify(s);
 }
@@ -223,6 +407,7 @@ static void watch_crate(struct selector *s, struct crate *c)
 
 void selector_init(struct selector *sel, struct library *lib)
 {
+    size_t n;
     struct crate *c;
 
     sel->library = lib;
@@ -237,17 +422,18 @@ void selector_init(struct selector *sel, struct library *lib)
     sel->sort = SORT_ARTIST;
     sel->search[0] = '\0';
     sel->search_len = 0;
+    match_compile(&sel->match, sel->search);
     sel->target = NULL;
 
-    index_init(&sel->index_a);
-    index_init(&sel->index_b);
-    sel->view_index = &sel->index_a;
-    sel->swap_index = &sel->index_b;
+    for (n = 0; n < ARRAY_SIZE(sel->level); n++) {
+        index_init(&sel->level[n]);
+        sel->stored[n] = false;
+    }
 
     c = current_crate(sel);
     watch_crate(sel, c);
 
-    (void)index_copy(initial(sel), sel->view_index);
+    update_view(sel);
     listbox_set_entries(&sel->records, sel->view_index->entries);
 
     event_init(&sel->changed);
@@ -259,8 +445,7 @@ void selector_clear(struct selector *sel)
     ignore(&sel->on_activity);
     ignore(&sel->on_refresh);
     ignore(&sel->on_addition);
-    index_clear(&sel->index_a);
-    index_clear(&sel->index_b);
+    forget_levels(sel);
 }
 
 /*
@@ -412,20 +597,22 @@ void selector_toggle_order(struct selector *sel)
 }
 
 /*
- * Request a re-scan on the currently selected crate
+ * Request a re-scan on the currently selected crate; a full re-scan,
+ * or only for the changes since the last one
  */
 
-void selector_rescan(struct selector *sel)
+void selector_rescan(struct selector *sel, bool full)
 {
     /* Ignore any errors at this point. A rescan must not leak
      * resources or cause a crash */
 
-    (void)library_rescan(sel->library, current_crate(sel));
+    (void)library_rescan(sel->library, current_crate(sel), full);
 }
 
 /*
- * Expand the search. Do not disrupt the running process on memory
- * allocation failure, leave the view index incomplete
+ * Expand the search, returning to the stored result where possible.
+ * Do not disrupt the running process on memory allocation failure,
+ * leave the view index incomplete
  */
 
 void selector_search_expand(struct selector *sel)
@@ -433,10 +620,14 @@ void selector_search_expand(struct selector *sel)
     if (sel->search_len == 0)
         return;
 
+    forget_level(sel, sel->search_len);
     sel->search[--sel->search_len] = '\0';
     match_compile(&sel->match, sel->search);
 
-    do_content_change(sel);
+    update_view(sel);
+    listbox_set_entries(&sel->records, sel->view_index->entries);
+    retain_target(sel);
+    notify(sel);
 }
 
 /*
@@ -451,8 +642,6 @@ void selector_search_expand(struct selector *sel)
 
 void selector_search_refine(struct selector *sel, char key)
 {
-    struct index *tmp;
-
     if (sel->search_len >= sizeof(sel->search) - 1) /* would overflow */
         return;
 
@@ -460,13 +649,19 @@ void selector_search_refine(struct selector *sel, char key)
     sel->search[++sel->search_len] = '\0';
     match_compile(&sel->match, sel->search);
 
-    (void)index_match(sel->view_index, sel->swap_index, &sel->match);
-
-    tmp = sel->view_index;
-    sel->view_index = sel->swap_index;
-    sel->swap_index = tmp;
-
+    update_view(sel);
     listbox_set_entries(&sel->records, sel->view_index->entries);
     set_target(sel);
     notify(sel);
 }
+
+/*
+ * Get the time spent searching since startup
+ *
+ * Pre: rig lock is held
+ */
+
+void selector_get_stats(struct selector_stats *s)
+{
+    *s = stats;
+}
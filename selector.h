@@ -28,10 +28,7 @@
 
 struct selector {
     struct library *library;
-    struct index
-        *view_index, /* base_index + search filter applied */
-        *swap_index, /* used to swap between a and b indexes */
-        index_a, index_b;
+    struct index *view_index; /* base_index + search filter applied */
 
     struct listbox records, crates;
     bool toggled;
@@ -43,9 +40,24 @@ struct selector {
     char search[256]; /* not unicode, one byte is one character */
     struct match match; /* the compiled search, kept in-sync */
 
+    /* The view for each length of the search string, so the search
+     * can be expanded without starting again. Level zero is the
+     * base index itself; others are only kept within a budget */
+
+    struct index level[256];
+    bool stored[256];
+
     struct event changed;
 };
 
+/* Time spent searching, by all selectors since startup */
+
+struct selector_stats {
+    unsigned long searches;
+    double searching, /* seconds, in total */
+        slowest; /* seconds, for a single search */
+};
+
 void selector_init(struct selector *sel, struct library *lib);
 void selector_clear(struct selector *sel);
 
@@ -64,9 +76,11 @@ void selector_prev(struct selector *sel);
 void selector_next(struct selector *sel);
 void selector_toggle(struct selector *sel);
 void selector_toggle_order(struct selector *sel);
-void selector_rescan(struct selector *sel);
+void selector_rescan(struct selector *sel, bool full);
 
 void selector_search_expand(struct selector *sel);
 void selector_search_refine(struct selector *sel, char key);
 
+void selector_get_stats(struct selector_stats *s);
+
 #endif
@@ -0,0 +1,586 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Snapshot of the listing of a crate
+ *
+ * The result of each scan is kept in a file, so that the crate can
+ * be shown straight away the next time; a scan takes a long time on
+ * a large library. The file is specific to this machine, and is
+ * simply discarded if it is not the expected version.
+ *
+ * Layout, in native byte order:
+ *
+ *   struct header
+ *   double bpm[records]
+ *   uint32_t by_artist[records], by_bpm[records] -- positions
+ *   char strings[] -- scan, path, then pathname, artist and title of
+ *                     each record in the order of the listing,
+ *                     each terminated by '\0'
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+
+#define MAGIC "xwaxsnap"
+#define VERSION 1
+
+struct header {
+    char magic[8];
+    uint32_t version, records;
+    uint64_t strings; /* bytes */
+};
+
+/* A snapshot being written by a thread of its own */
+
+struct snapshot_writer {
+    pthread_t ph;
+    struct listing copy; /* of the indexes only */
+    const char *scan, *path;
+};
+
+/*
+ * Hash function for the file name, FNV-1a
+ */
+
+static uint64_t hash(uint64_t h, const char *s)
+{
+    do {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211u;
+    } while (*s++ != '\0');
+
+    return h;
+}
+
+/*
+ * Get the directory for the snapshots, creating it if needed
+ *
+ * Return: 0 on success, or -1 if there is no directory
+ * Post: on success, buf contains the pathname
+ */
+
+static int directory(char *buf, size_t len)
+{
+    const char *base;
+    int z;
+
+    base = getenv("XDG_CACHE_HOME");
+    if (base != NULL && base[0] != '\0') {
+        z = snprintf(buf, len, "%s", base);
+    } else {
+        base = getenv("HOME");
+        if (base == NULL)
+            return -1;
+        z = snprintf(buf, len, "%s/.cache", base);
+    }
+
+    if (z < 0 || z + sizeof "/xwax" > len)
+        return -1;
+
+    if (mkdir(buf, 0700) == -1 && errno != EEXIST) {
+        perror("mkdir");
+        return -1;
+    }
+
+    strcat(buf, "/xwax");
+
+    if (mkdir(buf, 0700) == -1 && errno != EEXIST) {
+        perror("mkdir");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Get the pathname of the snapshot of the given scan
+ *
+ * Return: 0 on success, or -1 if there is no suitable location
+ */
+
+static int filename(char *buf, size_t len, const char *scan,
+                    const char *path)
+{
+    size_t z;
+    int n;
+
+    if (directory(buf, len) == -1)
+        return -1;
+
+    z = strlen(buf);
+    n = snprintf(buf + z, len - z, "/%016llx.snapshot",
+                 (unsigned long long)hash(hash(14695981039346656037u,
+                                               scan), path));
+    if (n < 0 || n >= len - z)
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Take the next string from the string table
+ *
+ * Return: pointer to string, or NULL if the table is exhausted
+ */
+
+static const char* next(const char **s, const char *end)
+{
+    const char *r, *x;
+
+    r = *s;
+    x = memchr(r, '\0', end - r);
+    if (x == NULL)
+        return NULL;
+
+    *s = x + 1;
+    return r;
+}
+
+/*
+ * Convert the mapped content of a snapshot into records
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int parse(struct listing *storage, struct listing *l,
+                 const char *base, size_t len, const char *scan,
+                 const char *path)
+{
+    size_t n, records;
+    const struct header *h;
+    const double *bpm;
+    const uint32_t *by_artist, *by_bpm;
+    const char *s, *end, *x;
+    struct record **r;
+
+    if (len < sizeof *h)
+        return -1;
+
+    h = (const struct header*)base;
+    if (memcmp(h->magic, MAGIC, sizeof h->magic) != 0)
+        return -1;
+    if (h->version != VERSION)
+        return -1;
+
+    records = h->records;
+    if (len != sizeof *h + records * (sizeof *bpm + 2 * sizeof *by_artist)
+        + h->strings)
+    {
+        return -1;
+    }
+
+    bpm = (const double*)(base + sizeof *h);
+    by_artist = (const uint32_t*)(bpm + records);
+    by_bpm = by_artist + records;
+    s = (const char*)(by_bpm + records);
+    end = s + h->strings;
+
+    /* Guard against a collision of the file names */
+
+    x = next(&s, end);
+    if (x == NULL || strcmp(x, scan) != 0)
+        return -1;
+
+    x = next(&s, end);
+    if (x == NULL || strcmp(x, path) != 0)
+        return -1;
+
+    r = malloc(sizeof *r * records);
+    if (r == NULL) {
+        perror("malloc");
+        return -1;
+    }
+
+    for (n = 0; n < records; n++) {
+        struct record t;
+
+        t.pathname = (char*)next(&s, end);
+        t.artist = (char*)next(&s, end);
+        t.title = (char*)next(&s, end);
+        t.bpm = bpm[n];
+
+        if (!t.pathname || !t.artist || !t.title)
+            goto fail;
+
+        r[n] = store_record(storage, &t);
+        if (r[n] == NULL)
+            goto fail;
+    }
+
+    /* Commonly, the first crate is also the first in the storage */
+
+    if (storage->by_order.entries == 0) {
+        if (listing_add_sorted(storage, r, records, by_artist, by_bpm) == -1)
+            goto fail;
+    } else {
+        if (listing_add_batch(storage, r, records) == -1)
+            goto fail;
+    }
+
+    if (listing_add_sorted(l, r, records, by_artist, by_bpm) == -1)
+        goto fail;
+
+    free(r);
+    return 0;
+
+fail:
+    free(r);
+    return -1;
+}
+
+/*
+ * Load the snapshot of the given scan, if there is one
+ *
+ * The records are added to the storage, which owns them.
+ *
+ * Return: listing of the crate with responsibility, or NULL if no
+ * snapshot is available
+ */
+
+struct listing* snapshot_load(struct listing *storage, const char *scan,
+                              const char *path)
+{
+    char pathname[4096];
+    int fd;
+    struct stat st;
+    void *base;
+    struct listing *l;
+
+    if (filename(pathname, sizeof pathname, scan, path) == -1)
+        return NULL;
+
+    fd = open(pathname, O_RDONLY);
+    if (fd == -1) {
+        if (errno != ENOENT)
+            perror("open");
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        goto fail;
+    }
+
+    if (st.st_size == 0)
+        goto fail;
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        goto fail;
+    }
+
+    l = malloc(sizeof *l);
+    if (l == NULL) {
+        perror("malloc");
+        goto fail_map;
+    }
+
+    listing_init(l);
+
+    if (parse(storage, l, base, st.st_size, scan, path) == -1) {
+        fprintf(stderr, "Ignoring snapshot %s of '%s'\n", pathname, path);
+        listing_clear(l);
+        free(l);
+        goto fail_map;
+    }
+
+    fprintf(stderr, "Snapshot of '%s', %zu records\n", path,
+            l->by_order.entries);
+
+    if (munmap(base, st.st_size) == -1)
+        abort();
+    if (close(fd) == -1)
+        abort();
+
+    return l;
+
+fail_map:
+    if (munmap(base, st.st_size) == -1)
+        abort();
+fail:
+    if (close(fd) == -1)
+        abort();
+    return NULL;
+}
+
+/*
+ * Comparison of pointer values, see qsort(3) and bsearch(3)
+ */
+
+static int ptrcompar(const void *a, const void *b)
+{
+    const struct record *x = *(struct record**)a, *y = *(struct record**)b;
+
+    if (x < y)
+        return -1;
+    if (x > y)
+        return 1;
+    return 0;
+}
+
+/*
+ * Write the positions in the listing of each entry of an index
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int write_order(FILE *f, const struct index *i,
+                       struct record **sorted, const uint32_t *position)
+{
+    size_t n;
+
+    for (n = 0; n < i->entries; n++) {
+        struct record **x;
+
+        x = bsearch(&i->record[n], sorted, i->entries, sizeof *sorted,
+                    ptrcompar);
+        assert(x != NULL);
+
+        if (fwrite(&position[x - sorted], sizeof *position, 1, f) != 1)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Write the content of the snapshot file
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+static int write_snapshot(FILE *f, const struct listing *l,
+                          const char *scan, const char *path)
+{
+    size_t n, records;
+    struct header h;
+    struct record **sorted;
+    uint32_t *position;
+    const struct index *order;
+
+    order = &l->by_order;
+    records = order->entries;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, MAGIC, sizeof h.magic);
+    h.version = VERSION;
+    h.records = records;
+    h.strings = strlen(scan) + strlen(path) + 2;
+
+    for (n = 0; n < records; n++) {
+        const struct record *r = order->record[n];
+
+        h.strings += strlen(r->pathname) + strlen(r->artist)
+            + strlen(r->title) + 3;
+    }
+
+    if (fwrite(&h, sizeof h, 1, f) != 1)
+        return -1;
+
+    for (n = 0; n < records; n++) {
+        if (fwrite(&order->record[n]->bpm, sizeof(double), 1, f) != 1)
+            return -1;
+    }
+
+    /* Translate each index to positions in the listing, by way of
+     * the records sorted by address */
+
+    sorted = malloc(sizeof *sorted * records);
+    position = malloc(sizeof *position * records);
+    if (sorted == NULL || position == NULL) {
+        perror("malloc");
+        free(sorted);
+        free(position);
+        return -1;
+    }
+
+    memcpy(sorted, order->record, sizeof *sorted * records);
+    qsort(sorted, records, sizeof *sorted, ptrcompar);
+
+    for (n = 0; n < records; n++) {
+        struct record **x;
+
+        x = bsearch(&order->record[n], sorted, records, sizeof *sorted,
+                    ptrcompar);
+        assert(x != NULL);
+        position[x - sorted] = n;
+    }
+
+    if (write_order(f, &l->by_artist, sorted, position) == -1
+        || write_order(f, &l->by_bpm, sorted, position) == -1)
+    {
+        free(sorted);
+        free(position);
+        return -1;
+    }
+
+    free(sorted);
+    free(position);
+
+    if (fwrite(scan, strlen(scan) + 1, 1, f) != 1)
+        return -1;
+    if (fwrite(path, strlen(path) + 1, 1, f) != 1)
+        return -1;
+
+    for (n = 0; n < records; n++) {
+        const struct record *r = order->record[n];
+
+        if (fwrite(r->pathname, strlen(r->pathname) + 1, 1, f) != 1)
+            return -1;
+        if (fwrite(r->artist, strlen(r->artist) + 1, 1, f) != 1)
+            return -1;
+        if (fwrite(r->title, strlen(r->title) + 1, 1, f) != 1)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Save the listing as the snapshot of the given scan, replacing any
+ * previous one
+ *
+ * Return: 0 on success, or -1 on error
+ */
+
+int snapshot_save(const struct listing *l, const char *scan,
+                  const char *path)
+{
+    char pathname[4096], tmp[4096 + 4];
+    FILE *f;
+
+    if (l->by_order.entries > UINT32_MAX)
+        return -1;
+
+    if (filename(pathname, sizeof pathname, scan, path) == -1)
+        return -1;
+
+    sprintf(tmp, "%s.tmp", pathname);
+
+    f = fopen(tmp, "w");
+    if (f == NULL) {
+        perror("fopen");
+        return -1;
+    }
+
+    if (write_snapshot(f, l, scan, path) == -1) {
+        perror("write");
+        fclose(f);
+        goto fail;
+    }
+
+    if (fclose(f) == EOF) {
+        perror("fclose");
+        goto fail;
+    }
+
+    if (rename(tmp, pathname) == -1) {
+        perror("rename");
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    if (unlink(tmp) == -1)
+        perror("unlink");
+    return -1;
+}
+
+static void* launch(void *p)
+{
+    struct snapshot_writer *w = p;
+
+    (void)snapshot_save(&w->copy, w->scan, w->path);
+    return NULL;
+}
+
+/*
+ * Begin to save the listing as the snapshot of the given scan, in
+ * another thread
+ *
+ * The indexes are copied so the listing can change in the meantime,
+ * but not the records; these must remain, and the scan and path
+ * strings, until snapshot_finish().
+ *
+ * Return: handle for snapshot_finish(), or NULL on error
+ */
+
+struct snapshot_writer* snapshot_start(const struct listing *l,
+                                       const char *scan, const char *path)
+{
+    int r;
+    struct snapshot_writer *w;
+
+    w = malloc(sizeof *w);
+    if (w == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    listing_init(&w->copy);
+    w->scan = scan;
+    w->path = path;
+
+    if (index_copy(&l->by_artist, &w->copy.by_artist) == -1
+        || index_copy(&l->by_bpm, &w->copy.by_bpm) == -1
+        || index_copy(&l->by_order, &w->copy.by_order) == -1)
+    {
+        goto fail;
+    }
+
+    r = pthread_create(&w->ph, NULL, launch, w);
+    if (r != 0) {
+        errno = r;
+        perror("pthread_create");
+        goto fail;
+    }
+
+    return w;
+
+fail:
+    listing_clear(&w->copy);
+    free(w);
+    return NULL;
+}
+
+/*
+ * Wait for a snapshot to be written, and free the handle
+ */
+
+void snapshot_finish(struct snapshot_writer *w)
+{
+    if (pthread_join(w->ph, NULL) != 0)
+        abort();
+
+    listing_clear(&w->copy);
+    free(w);
+}
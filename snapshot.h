@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "library.h"
+
+struct listing* snapshot_load(struct listing *storage, const char *scan,
+                              const char *path);
+int snapshot_save(const struct listing *l, const char *scan,
+                  const char *path);
+
+struct snapshot_writer* snapshot_start(const struct listing *l,
+                                       const char *scan, const char *path);
+void snapshot_finish(struct snapshot_writer *w);
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of the audio path from end to end
+ *
+ * Decks are built on file devices, which read a recording as quickly
+ * as possible through the timecoder and player, each playing a track
+ * of noise. Output is the speed relative to real time for each number
+ * of decks, one tab-separated line each, suitable for comparison
+ * between builds. Finally, one deck is given a shorter recording;
+ * the others must not slow down once it has ended.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "deck.h"
+#include "file.h"
+#include "pool.h"
+#include "realtime.h"
+#include "rig.h"
+#include "thread.h"
+#include "xwax.h"
+
+#define RATE 44100
+#define PERIOD 256 /* samples */
+#define SECONDS 60 /* of input to each deck */
+#define SHORT 1 /* of input to a deck which ends early */
+
+/* Used by the metrics, normally provided by xwax.c */
+
+size_t ndeck;
+struct deck deck[MAX_DECKS];
+
+static struct record noise = {
+    .pathname = "noise",
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* launch(void *p)
+{
+    rig_main();
+    return NULL;
+}
+
+/*
+ * Write a recording of noise of the given length; the timecoder does
+ * the same work whether or not it finds a timecode
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int record(const char *path, unsigned int seconds)
+{
+    FILE *f;
+    unsigned long n;
+    unsigned int seed;
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    seed = 0xbeefface;
+
+    for (n = 0; n < (unsigned long)RATE * seconds * 2; n++) {
+        signed short s;
+
+        seed = seed * 1103515245 + 12345;
+        s = (seed >> 16) - 32768;
+        fwrite(&s, sizeof s, 1, f);
+    }
+
+    if (fclose(f) != 0) {
+        perror("fclose");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Return: true if all tracks have finished loading
+ */
+
+static bool ready(void)
+{
+    size_t n;
+    bool r;
+
+    r = true;
+
+    rig_lock();
+
+    for (n = 0; n < ndeck; n++) {
+        if (track_is_importing(deck[n].player.track))
+            r = false;
+    }
+
+    rig_unlock();
+
+    return r;
+}
+
+/*
+ * Play the recording on the given number of decks, until the end
+ *
+ * If given, the first deck plays the short recording instead.
+ *
+ * Return: the speed relative to real time, or -1.0 on error
+ */
+
+static double run(const char *path, const char *first,
+                  struct timecode_def *timecode, size_t decks)
+{
+    size_t n;
+    pthread_t ph;
+    struct rt rt;
+    double start, elapsed;
+
+    rt_init(&rt);
+
+    for (ndeck = 0; ndeck < decks; ndeck++) {
+        struct deck *k = &deck[ndeck];
+        const char *input;
+
+        input = (ndeck == 0 && first != NULL) ? first : path;
+
+        if (file_init(&k->device, input, NULL, RATE, PERIOD) == -1)
+            return -1.0;
+
+        if (deck_init(k, &rt, timecode, "tests/import-noise",
+                      1.0, false, false, false) == -1)
+        {
+            return -1.0;
+        }
+
+        player_set_internal_playback(&k->player);
+    }
+
+    if (pthread_create(&ph, NULL, launch, NULL) != 0) {
+        perror("pthread_create");
+        return -1.0;
+    }
+
+    rig_lock();
+    for (n = 0; n < ndeck; n++)
+        deck_load(&deck[n], &noise);
+    rig_unlock();
+
+    while (!ready())
+        usleep(10000);
+
+    /* The rig exits when every file device reaches the end */
+
+    start = now();
+
+    if (rt_start(&rt, 0) == -1)
+        return -1.0;
+
+    if (pthread_join(ph, NULL) != 0)
+        abort();
+
+    elapsed = now() - start;
+
+    rt_stop(&rt);
+
+    for (n = 0; n < ndeck; n++)
+        deck_clear(&deck[n]);
+
+    rt_clear(&rt);
+
+    return SECONDS / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int failures;
+    size_t decks;
+    double speed;
+    char path[] = "/tmp/xwax-device-bench.XXXXXX",
+        short_path[] = "/tmp/xwax-device-bench.XXXXXX";
+    struct timecode_def *timecode;
+
+    failures = 0;
+
+    if (thread_global_init() == -1)
+        return EXIT_FAILURE;
+    if (pool_global_init(0) == -1)
+        return EXIT_FAILURE;
+    if (rig_init() == -1)
+        return EXIT_FAILURE;
+
+    /* Tracks are at least as long as the recording */
+
+    if (setenv("LENGTH", "70", 1) == -1) {
+        perror("setenv");
+        return EXIT_FAILURE;
+    }
+
+    if (mkstemp(path) == -1) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+
+    if (mkstemp(short_path) == -1) {
+        perror("mkstemp");
+        goto out_path;
+    }
+
+    if (record(path, SECONDS) == -1 || record(short_path, SHORT) == -1)
+        goto out;
+
+    timecode = timecoder_find_definition("serato_2a");
+    if (timecode == NULL)
+        abort();
+
+    printf("decks\tseconds\tfirst_seconds\tspeed\n");
+
+    for (decks = 1; decks <= MAX_DECKS; decks++) {
+        speed = run(path, NULL, timecode, decks);
+        if (speed < 0.0) {
+            failures++;
+            break;
+        }
+
+        printf("%zu\t%d\t%d\t%.1f\n", decks, SECONDS, SECONDS, speed);
+
+        /* The decks must keep up with real time */
+
+        if (speed < 1.0) {
+            fprintf(stderr, "%zu decks are slower than real time\n", decks);
+            failures++;
+        }
+    }
+
+    /* The end of one input must not hold up the others */
+
+    speed = run(path, short_path, timecode, MAX_DECKS);
+    if (speed < 0.0) {
+        failures++;
+    } else {
+        printf("%d\t%d\t%d\t%.1f\n", MAX_DECKS, SECONDS, SHORT, speed);
+
+        if (speed < 1.0) {
+            fprintf(stderr, "Decks are slower than real time after one "
+                    "has ended\n");
+            failures++;
+        }
+    }
+
+    timecoder_free_lookup();
+
+out:
+    if (unlink(short_path) == -1)
+        perror("unlink");
+out_path:
+    if (unlink(path) == -1)
+        perror("unlink");
+
+    rig_clear();
+    pool_global_clear();
+    thread_global_clear();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
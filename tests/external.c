@@ -68,7 +68,6 @@ int main(int argc, char *argv[])
 
         strings++;
         fprintf(stderr, "(%u, %u) %s\n", cycles, strings, s);
-        free(s);
     }
 
     fprintf(stderr, "%u cycles, %u strings\n", cycles, strings);
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of matching and sorting a large index with a
+ * number of threads
+ *
+ * Output is one tab-separated line per operation and number of
+ * threads, suitable for comparison between builds and machines.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "index.h"
+#include "pool.h"
+
+#define RECORDS 1000000
+#define REPEAT 3 /* take the fastest */
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+static const unsigned int threads[] = { 1, 2, 4, 8 };
+
+static const struct operation {
+    const char *name, *search;
+    int sort;
+    bool keys; /* use the packed search keys */
+} operations[] = {
+    { "match", "ka", 0, false },
+    { "match", "ka", 0, true },
+    { "match", "zzz", 0, false },
+    { "match", "zzz", 0, true },
+    { "match", "lo ra", 0, false },
+    { "match", "lo ra", 0, true },
+    { "sort", NULL, SORT_ARTIST, true },
+    { "sort", NULL, SORT_BPM, true },
+};
+
+static const char *syllables[] = {
+    "ka", "lo", "mi", "ra", "to", "ne", "su", "vi", "de", "po", "la", "ri",
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static struct record* synthesise(size_t i)
+{
+    char buf[256];
+    struct record *x;
+    int len, a, t, n;
+
+    x = malloc(sizeof *x);
+    if (x == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    len = snprintf(buf, sizeof buf, "/music/%zu.mp3", i) + 1;
+
+    a = len;
+    for (n = 0; n < 3; n++)
+        len += sprintf(buf + len, "%s", syllables[rand() % ARRAY_SIZE(syllables)]);
+    len++;
+
+    t = len;
+    for (n = 0; n < 6; n++)
+        len += sprintf(buf + len, "%s", syllables[rand() % ARRAY_SIZE(syllables)]);
+    len++;
+
+    x->pathname = malloc(len);
+    if (x->pathname == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    memcpy(x->pathname, buf, len);
+    x->artist = x->pathname + a;
+    x->title = x->pathname + t;
+    x->match = NULL;
+    x->key = NULL;
+    x->bpm = (rand() % 4) ? 60.0 + rand() % 12000 / 100.0 : 0.0;
+
+    return x;
+}
+
+/*
+ * Give, or take away, the search key of every record
+ */
+
+static void set_keys(struct index *all, const char **keys, bool on)
+{
+    size_t n;
+
+    for (n = 0; n < all->entries; n++)
+        all->record[n]->key = on ? keys[n] : NULL;
+}
+
+/*
+ * Run the operation on the index
+ *
+ * Return: time taken, in seconds
+ */
+
+static double run(const struct operation *op, struct index *src,
+                  struct index *dest)
+{
+    double start;
+
+    if (op->search) {
+        struct match m;
+
+        match_compile(&m, op->search);
+
+        start = now();
+        if (index_match(src, dest, &m) == -1)
+            abort();
+        return now() - start;
+
+    } else {
+        if (index_copy(src, dest) == -1)
+            abort();
+
+        start = now();
+        index_sort(dest->record, dest->entries, op->sort);
+        return now() - start;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n, o, t, failures;
+    const char **keys;
+    struct arena arena;
+    struct index all, reference[ARRAY_SIZE(operations)];
+
+    failures = 0;
+
+    index_init(&all);
+    if (index_reserve(&all, RECORDS) == -1)
+        return EXIT_FAILURE;
+
+    keys = malloc(sizeof *keys * RECORDS);
+    if (keys == NULL) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    for (n = 0; n < RECORDS; n++)
+        index_add(&all, synthesise(n));
+
+    /* Records are scattered in memory when in artist order, as they
+     * are in a library */
+
+    index_sort(all.record, all.entries, SORT_ARTIST);
+
+    arena_init(&arena);
+
+    for (n = 0; n < RECORDS; n++) {
+        if (record_key(all.record[n], &arena) == -1)
+            return EXIT_FAILURE;
+        keys[n] = all.record[n]->key;
+    }
+
+    printf("records\toperation\tsearch\tsort\tkeys\tthreads\tms\tspeedup\n");
+
+    for (o = 0; o < ARRAY_SIZE(operations); o++) {
+        const struct operation *op = &operations[o];
+        double single;
+
+        set_keys(&all, keys, op->keys);
+
+        index_init(&reference[o]);
+        single = 0.0;
+
+        for (t = 0; t < ARRAY_SIZE(threads); t++) {
+            struct index result;
+            double best;
+            int r;
+
+            if (pool_global_init(threads[t]) == -1)
+                return EXIT_FAILURE;
+
+            index_init(&result);
+
+            best = 0.0;
+            for (r = 0; r < REPEAT; r++) {
+                double x;
+
+                x = run(op, &all, &result);
+                if (r == 0 || x < best)
+                    best = x;
+            }
+
+            pool_global_clear();
+
+            if (t == 0) {
+                single = best;
+                if (index_copy(&result, &reference[o]) == -1)
+                    return EXIT_FAILURE;
+
+            } else if (result.entries != reference[o].entries
+                       || memcmp(result.record, reference[o].record,
+                                 sizeof(struct record*) * result.entries))
+            {
+                fprintf(stderr, "%s: %u threads gave a different result\n",
+                        op->name, threads[t]);
+                failures++;
+            }
+
+            printf("%d\t%s\t%s\t%d\t%d\t%u\t%.2f\t%.2f\n", RECORDS, op->name,
+                   op->search ? op->search : "", op->sort, op->keys,
+                   threads[t], best * 1000, single / best);
+
+            index_clear(&result);
+        }
+
+        index_clear(&reference[o]);
+    }
+
+    for (n = 0; n < all.entries; n++) {
+        free(all.record[n]->pathname);
+        free(all.record[n]);
+    }
+
+    index_clear(&all);
+    arena_clear(&arena);
+    free(keys);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
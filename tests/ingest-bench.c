@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of reading the output of a scan
+ *
+ * Generate a series of records with the scan-bpm script, then read
+ * them as the excrate does; as lines only, then parsed into records
+ * and added to a listing. Output is one tab-separated line per
+ * method, suitable for comparison between builds.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "external.h"
+#include "library.h"
+
+#define LINES 1000000
+#define BATCH 1024 /* records per batch, as the excrate */
+
+#define LOWEST 30.0
+#define HIGHEST 320.0
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Run the generator into a temporary file
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int generate(size_t lines, const char *pathname)
+{
+    char step[32], buf[65536];
+    int fd, out, status;
+    pid_t pid;
+    ssize_t z;
+
+    snprintf(step, sizeof step, "%.9f", (HIGHEST - LOWEST) / lines);
+    if (setenv("STEP", step, 1) == -1) {
+        perror("setenv");
+        return -1;
+    }
+
+    out = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out == -1) {
+        perror(pathname);
+        return -1;
+    }
+
+    pid = fork_pipe(&fd, "tests/scan-bpm", "scan-bpm", "/dev/null", NULL);
+    if (pid == -1)
+        return -1;
+
+    while ((z = read(fd, buf, sizeof buf)) > 0) {
+        if (write(out, buf, z) != z) {
+            perror("write");
+            return -1;
+        }
+    }
+
+    close(fd);
+    close(out);
+
+    if (waitpid(pid, &status, 0) == -1)
+        abort();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Read the lines of the file, and optionally add them to a listing
+ *
+ * Return: number of lines, or records in the listing
+ */
+
+static size_t ingest(const char *pathname, bool parse)
+{
+    int fd;
+    size_t lines, n, records;
+    struct rb rb;
+    struct listing storage, l;
+    struct record *d[BATCH];
+
+    fd = open(pathname, O_RDONLY);
+    if (fd == -1) {
+        perror(pathname);
+        abort();
+    }
+
+    listing_init(&storage);
+    listing_init(&l);
+    rb_reset(&rb);
+
+    lines = 0;
+    n = 0;
+
+    for (;;) {
+        char *line;
+        ssize_t z;
+
+        if (n == BATCH) {
+            if (listing_add_batch(&storage, d, n) == -1)
+                abort();
+            if (listing_add_batch(&l, d, n) == -1)
+                abort();
+            n = 0;
+        }
+
+        z = get_line(fd, &rb, &line);
+        if (z == -1) {
+            perror("get_line");
+            abort();
+        }
+        if (z == 0)
+            break;
+
+        lines++;
+
+        if (parse) {
+            d[n] = get_record(&storage, line);
+            if (d[n] != NULL)
+                n++;
+        }
+    }
+
+    if (listing_add_batch(&storage, d, n) == -1)
+        abort();
+    if (listing_add_batch(&l, d, n) == -1)
+        abort();
+
+    close(fd);
+
+    records = parse ? l.by_order.entries : lines;
+
+    listing_clear(&l);
+    listing_clear(&storage);
+
+    return records;
+}
+
+int main(int argc, char *argv[])
+{
+    char pathname[] = "/tmp/xwax-ingest-bench-XXXXXX";
+    size_t lines, count[2];
+    int fd, method, failures;
+
+    lines = (argc > 1) ? strtoul(argv[1], NULL, 10) : LINES;
+    failures = 0;
+
+    if (library_global_init() == -1)
+        return EXIT_FAILURE;
+
+    fd = mkstemp(pathname);
+    if (fd == -1) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    if (generate(lines, pathname) == -1) {
+        fprintf(stderr, "Generator failed\n");
+        unlink(pathname);
+        return EXIT_FAILURE;
+    }
+
+    printf("lines\tmethod\tlines_per_sec\n");
+
+    for (method = 0; method < 2; method++) {
+        double start, elapsed;
+
+        start = now();
+        count[method] = ingest(pathname, method == 1);
+        elapsed = now() - start;
+
+        printf("%zu\t%s\t%.0f\n", count[0], method ? "records" : "lines",
+               count[0] / elapsed);
+    }
+
+    /* Every line of the generator is a distinct record */
+
+    if (count[1] != count[0]) {
+        fprintf(stderr, "%zu lines gave %zu records\n", count[0], count[1]);
+        failures++;
+    }
+
+    if (unlink(pathname) == -1)
+        perror("unlink");
+
+    library_global_clear();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of drawing the interface
+ *
+ * Decks are given tracks of noise and the library a long list of
+ * records, then the interface is drawn to an offscreen window at a
+ * range of sizes and scales. Output is the time spent in each area of
+ * the interface per frame, one tab-separated line per area, suitable
+ * for comparison between builds.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dummy.h"
+#include "interface.h"
+#include "library.h"
+#include "pool.h"
+#include "realtime.h"
+#include "rig.h"
+#include "thread.h"
+#include "xwax.h"
+
+#define FRAMES 500
+#define FPS 60.0 /* rate at which the decks are moved between frames */
+#define BUDGET 10.0 /* milliseconds per frame, the refresh interval */
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+/* Used by the interface, normally provided by xwax.c */
+
+char *banner = "xwax interface benchmark";
+size_t ndeck;
+struct deck deck[MAX_DECKS];
+
+static const char *geometry[] = {
+    "960x720",
+    "1280x960",
+    "1920x1080",
+    "1920x1200/1.6",
+    "2560x1440/2",
+};
+
+static void* launch(void *p)
+{
+    rig_main();
+    return NULL;
+}
+
+/*
+ * Return: true if the library and all tracks have finished loading
+ */
+
+static bool ready(struct library *lib)
+{
+    size_t n;
+    bool r;
+
+    rig_lock();
+
+    r = (lib->storage.by_order.entries > 0);
+
+    for (n = 0; n < lib->crates; n++) {
+        if (lib->crate[n]->is_busy)
+            r = false;
+    }
+
+    for (n = 0; n < ndeck; n++) {
+        if (track_is_importing(deck[n].player.track))
+            r = false;
+    }
+
+    rig_unlock();
+
+    return r;
+}
+
+/*
+ * Report the time spent in each area of the interface
+ *
+ * Return: average time per frame, in milliseconds
+ */
+
+static double report(const char *geo, const char *mode)
+{
+    struct interface_timing t;
+    double ms;
+
+    interface_timing(&t);
+    if (t.frames == 0)
+        return 0.0;
+
+    ms = 1000.0 / t.frames;
+
+    printf("%s\t%s\ttotal\t%.3f\n", geo, mode, t.total * ms);
+    printf("%s\t%s\tlibrary\t%.3f\n", geo, mode, t.library * ms);
+    printf("%s\t%s\tstatus\t%.3f\n", geo, mode, t.status * ms);
+    printf("%s\t%s\tdecks\t%.3f\n", geo, mode, t.decks * ms);
+    printf("%s\t%s\tmeters\t%.3f\n", geo, mode, t.meters * ms);
+    printf("%s\t%s\tscope\t%.3f\n", geo, mode, t.scope * ms);
+    printf("%s\t%s\tspinner\t%.3f\n", geo, mode, t.spinner * ms);
+    printf("%s\t%s\ttext\t%.3f\n", geo, mode, t.text * ms);
+
+    return t.total * ms;
+}
+
+/*
+ * Draw frames with the decks playing
+ *
+ * Return: average time per frame, in milliseconds
+ */
+
+static double run(const char *geo, const char *mode, bool full)
+{
+    int f;
+    size_t n;
+    struct interface_timing first;
+
+    /* Exclude the first frame, which draws everything regardless */
+
+    interface_draw(true);
+    interface_timing(&first);
+
+    for (f = 0; f < FRAMES; f++) {
+        for (n = 0; n < ndeck; n++)
+            deck[n].player.position += 1.0 / FPS;
+
+        interface_draw(full);
+    }
+
+    return report(geo, mode);
+}
+
+int main(int argc, char *argv[])
+{
+    int failures;
+    size_t n, d;
+    pthread_t ph;
+    struct rt rt;
+    struct library lib;
+    struct timecode_def *timecode;
+
+    failures = 0;
+
+    /* Draw offscreen, unless told otherwise */
+
+    if (setenv("SDL_VIDEODRIVER", "dummy", 0) == -1) {
+        perror("setenv");
+        return EXIT_FAILURE;
+    }
+
+    if (thread_global_init() == -1)
+        return EXIT_FAILURE;
+    if (pool_global_init(0) == -1)
+        return EXIT_FAILURE;
+    if (library_global_init() == -1)
+        return EXIT_FAILURE;
+    if (rig_init() == -1)
+        return EXIT_FAILURE;
+
+    rt_init(&rt);
+
+    if (library_init(&lib) == -1)
+        return EXIT_FAILURE;
+
+    /* A library of around 30,000 records */
+
+    if (setenv("STEP", "0.01", 1) == -1) {
+        perror("setenv");
+        return EXIT_FAILURE;
+    }
+
+    if (library_import(&lib, "tests/scan-bpm", "bpm") == -1)
+        return EXIT_FAILURE;
+
+    timecode = timecoder_find_definition("serato_2a");
+    if (timecode == NULL)
+        abort();
+
+    for (ndeck = 0; ndeck < MAX_DECKS; ndeck++) {
+        struct deck *k = &deck[ndeck];
+
+        dummy_init(&k->device);
+
+        if (deck_init(k, &rt, timecode, "tests/import-noise",
+                      1.0, false, false, false) == -1)
+        {
+            return EXIT_FAILURE;
+        }
+
+        player_set_timecode_control(&k->player, true);
+    }
+
+    if (pthread_create(&ph, NULL, launch, NULL) != 0) {
+        perror("pthread_create");
+        return EXIT_FAILURE;
+    }
+
+    while (!ready(&lib))
+        usleep(10000);
+
+    rig_lock();
+    for (d = 0; d < ndeck; d++)
+        deck_load(&deck[d], lib.storage.by_order.record[d]);
+    rig_unlock();
+
+    while (!ready(&lib))
+        usleep(10000);
+
+    fprintf(stderr, "%zu records, %zu decks\n",
+            lib.storage.by_order.entries, ndeck);
+
+    printf("geometry\tmode\tarea\tms_per_frame\n");
+
+    for (n = 0; n < ARRAY_SIZE(geometry); n++) {
+        double ms;
+
+        if (interface_init(&lib, geometry[n], true) == -1) {
+            failures++;
+            continue;
+        }
+
+        run(geometry[n], "full", true);
+        ms = run(geometry[n], "update", false);
+
+        interface_clear();
+
+        /* The interface requests the scopes again at the next size;
+         * safe as there is no realtime thread */
+
+        for (d = 0; d < ndeck; d++)
+            timecoder_clear_scope(&deck[d].timecoder);
+
+        /* Normal drawing must keep up with the refresh */
+
+        if (ms > BUDGET) {
+            fprintf(stderr, "%s: %.3fms per frame exceeds %.1fms\n",
+                    geometry[n], ms, BUDGET);
+            failures++;
+        }
+    }
+
+    rig_quit();
+
+    if (pthread_join(ph, NULL) != 0)
+        abort();
+
+    for (d = 0; d < ndeck; d++)
+        deck_clear(&deck[d]);
+
+    timecoder_free_lookup();
+    library_clear(&lib);
+    rt_clear(&rt);
+    rig_clear();
+    library_global_clear();
+    pool_global_clear();
+    thread_global_clear();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
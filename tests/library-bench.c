@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of adding records to a library listing
+ *
+ * Synthesise a library and add it to a listing, one record at a time
+ * and in batches as if from a scan, with the odd duplicate within a
+ * batch; then again, as all duplicates, as if from a rescan. Output
+ * is one tab-separated line per size and method, suitable for
+ * comparison between builds. Batches must be no slower than adding
+ * one record at a time, within a margin for noise.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "library.h"
+
+#define BATCH 1024 /* records per batch, as the excrate */
+#define ARTISTS 16 /* records per artist, on average */
+#define DUPLICATE 97 /* every so many records repeats a recent one */
+#define MARGIN 0.5 /* of the speed of the reference, for a regression */
+#define TIMED 10000 /* fewer records take too little time to compare */
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+static const size_t sizes[] = { 1000, 10000, 100000 };
+
+static const struct method {
+    const char *name;
+    size_t batch; /* or zero for listing_add() */
+} methods[] = {
+    { "single", 0 },
+    { "batch", BATCH },
+};
+
+struct result {
+    double load, rescan; /* records per second */
+    bool ok;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Synthesise n records, in the order a scan might give them
+ */
+
+static struct record** synthesise(size_t n, unsigned int seed)
+{
+    size_t i;
+    struct record **r;
+
+    r = malloc(sizeof *r * n);
+    if (r == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    srand(seed);
+
+    for (i = 0; i < n; i++) {
+        char buf[256];
+        struct record *x;
+        int len;
+
+        x = malloc(sizeof *x);
+        if (x == NULL) {
+            perror("malloc");
+            abort();
+        }
+
+        len = snprintf(buf, sizeof buf, "/music/%zu.mp3%cArtist %d%cTitle %d",
+                       i, '\0', (int)(rand() % (n / ARTISTS + 1)), '\0', rand());
+
+        /* A repeat of a recent record, but distinguishable by its
+         * BPM; only the first of the two must be kept */
+
+        if (i > 0 && i % DUPLICATE == 0) {
+            struct record *y;
+
+            y = r[i - 3];
+            len = y->title + strlen(y->title) - y->pathname;
+            memcpy(buf, y->pathname, len + 1);
+        }
+
+        x->pathname = malloc(len + 1);
+        if (x->pathname == NULL) {
+            perror("malloc");
+            abort();
+        }
+
+        memcpy(x->pathname, buf, len + 1);
+        x->artist = x->pathname + strlen(x->pathname) + 1;
+        x->title = x->artist + strlen(x->artist) + 1;
+        x->match = NULL;
+        x->key = NULL;
+        x->bpm = (rand() % 4) ? 60.0 + rand() % 12000 / 100.0 : 0.0;
+
+        if (i > 0 && i % DUPLICATE == 0)
+            x->bpm = r[i - 3]->bpm + 1.0;
+
+        r[i] = x;
+    }
+
+    return r;
+}
+
+static void discard(struct record **r, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        free(r[i]->pathname);
+        free(r[i]);
+    }
+
+    free(r);
+}
+
+/*
+ * Add the records using the given method
+ *
+ * Post: r[] contains the entries in the listing
+ */
+
+static void add(struct listing *l, struct record **r, size_t n,
+                const struct method *m)
+{
+    size_t i;
+
+    if (m->batch == 0) {
+        for (i = 0; i < n; i++) {
+            r[i] = listing_add(l, r[i]);
+            if (r[i] == NULL)
+                abort();
+        }
+        return;
+    }
+
+    for (i = 0; i < n; i += m->batch) {
+        size_t len;
+
+        len = n - i < m->batch ? n - i : m->batch;
+        if (listing_add_batch(l, r + i, len) == -1)
+            abort();
+    }
+}
+
+static bool same_index(const struct index *a, const struct index *b)
+{
+    size_t i;
+
+    if (a->entries != b->entries)
+        return false;
+
+    for (i = 0; i < a->entries; i++) {
+        if (strcmp(a->record[i]->pathname, b->record[i]->pathname) != 0)
+            return false;
+        if (a->record[i]->bpm != b->record[i]->bpm)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Add a library of n records, then the same again
+ *
+ * The result is compared against the reference listing, if given
+ */
+
+static void run(size_t n, const struct method *m, struct listing *l,
+                const struct listing *ref, struct result *res)
+{
+    size_t i, unique;
+    double start;
+    struct record **scan, **rescan, **x;
+
+    scan = synthesise(n, 1);
+    rescan = synthesise(n, 1);
+    unique = n - (n - 1) / DUPLICATE;
+
+    x = malloc(sizeof *x * n);
+    if (x == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    memcpy(x, scan, sizeof *x * n);
+
+    start = now();
+    add(l, scan, n, m);
+    res->load = n / (now() - start);
+
+    /* The duplicates within the scan must give the earlier entry */
+
+    res->ok = true;
+
+    for (i = 0; i < n; i++) {
+        if (scan[i] == x[i])
+            continue;
+
+        if (i % DUPLICATE != 0 || scan[i] != scan[i - 3])
+            res->ok = false;
+
+        free(x[i]->pathname);
+        free(x[i]);
+    }
+
+    memcpy(x, rescan, sizeof *x * n);
+
+    start = now();
+    add(l, x, n, m);
+    res->rescan = n / (now() - start);
+
+    /* The rescan must only find the existing entries */
+
+    for (i = 0; i < n; i++) {
+        if (x[i] != scan[i])
+            res->ok = false;
+    }
+
+    if (l->by_artist.entries != unique || l->by_order.entries != unique)
+        res->ok = false;
+
+    if (ref != NULL) {
+        if (!same_index(&l->by_artist, &ref->by_artist))
+            res->ok = false;
+        if (!same_index(&l->by_bpm, &ref->by_bpm))
+            res->ok = false;
+        if (!same_index(&l->by_order, &ref->by_order))
+            res->ok = false;
+    }
+
+    discard(rescan, n);
+    free(x);
+    free(scan); /* records are still in the listing */
+}
+
+static void listing_discard(struct listing *l)
+{
+    size_t i;
+
+    for (i = 0; i < l->by_order.entries; i++) {
+        free(l->by_order.record[i]->pathname);
+        free(l->by_order.record[i]);
+    }
+
+    listing_clear(l);
+}
+
+int main(int argc, char *argv[])
+{
+    int n, m, failures;
+
+    failures = 0;
+
+    printf("records\tmethod\tload_per_sec\trescan_per_sec\n");
+
+    for (n = 0; n < ARRAY_SIZE(sizes); n++) {
+        struct listing l[ARRAY_SIZE(methods)];
+        struct result ref = { 0.0, 0.0, true };
+
+        for (m = 0; m < ARRAY_SIZE(methods); m++) {
+            struct result res;
+
+            /* The first method is the reference for the others */
+
+            listing_init(&l[m]);
+            run(sizes[n], &methods[m], &l[m], m == 0 ? NULL : &l[0], &res);
+
+            printf("%zu\t%s\t%.0f\t%.0f\n", sizes[n], methods[m].name,
+                   res.load, res.rescan);
+
+            if (!res.ok) {
+                fprintf(stderr, "%zu records: %s gave a different listing\n",
+                        sizes[n], methods[m].name);
+                failures++;
+            }
+
+            if (m == 0) {
+                ref = res;
+            } else if (sizes[n] >= TIMED
+                       && (res.load < ref.load * MARGIN
+                           || res.rescan < ref.rescan * MARGIN))
+            {
+                fprintf(stderr, "%zu records: %s is slower than %s\n",
+                        sizes[n], methods[m].name, methods[0].name);
+                failures++;
+            }
+        }
+
+        for (m = 0; m < ARRAY_SIZE(methods); m++)
+            listing_discard(&l[m]);
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of scanning a music library
+ *
+ * Synthesise a directory tree of empty files, named in the various
+ * ways which the scan recognises, and scan it with the scan script
+ * and the built-in scanner; a full scan, then for the changes since
+ * a manifest. Output is one tab-separated line per scanner and type
+ * of scan, suitable for comparison between builds; exit status is
+ * non-zero if the scanners do not agree.
+ */
+
+#define _GNU_SOURCE /* asprintf() */
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "external.h"
+#include "scanner.h"
+
+#define FILES 100000
+#define PER_DIRECTORY 100
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+/* Pathnames of each form, within a directory of each album */
+
+static const char *forms[] = {
+    "%s/%d Artist %d - Title %d.mp3",
+    "%s/Artist %d - Title %d (%d.5 BPM).flac",
+    "%s/A%d. Title %d %d.ogg",
+    "%s/Disc 1/%d Title %d (%d BPM).m4a",
+    "%s/SIDE B/B%d Title %d - Mix %d.MP3",
+    "%s/cover %d %d %d.jpg",
+};
+
+struct output {
+    char *buf;
+    size_t len, size;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_directory(const char *path)
+{
+    if (mkdir(path, 0700) == -1 && errno != EEXIST) {
+        perror(path);
+        abort();
+    }
+}
+
+static void touch(const char *path)
+{
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT, 0600);
+    if (fd == -1) {
+        perror(path);
+        abort();
+    }
+
+    close(fd);
+}
+
+/*
+ * Synthesise a library of n files in the given directory, and a
+ * manifest of a scan which preceded some changes
+ */
+
+static void synthesise(const char *root, size_t n, const char *manifest)
+{
+    size_t i;
+    FILE *f;
+
+    f = fopen(manifest, "w");
+    if (f == NULL) {
+        perror(manifest);
+        abort();
+    }
+
+    for (i = 0; i < n; i++) {
+        char dir[2048], path[4096];
+        int form;
+
+        snprintf(dir, sizeof dir, "%s/Artist %zu - Album %zu",
+                 root, i / PER_DIRECTORY, i / PER_DIRECTORY);
+        make_directory(dir);
+
+        form = i % ARRAY_SIZE(forms);
+        snprintf(path, sizeof path, forms[form],
+                 dir, (int)(i % 20), (int)i, 60 + (int)(i % 120));
+
+        *strrchr(path, '/') = '\0';
+        make_directory(path); /* eg. "Disc 1" */
+
+        snprintf(path, sizeof path, forms[form],
+                 dir, (int)(i % 20), (int)i, 60 + (int)(i % 120));
+
+        /* One in 64 files is new since the manifest, and one in 64
+         * of the manifest has gone */
+
+        if (i % 64 != 0)
+            touch(path);
+        if (i % 64 != 1 && strstr(path, ".jpg") == NULL)
+            fprintf(f, "%s\n", path);
+    }
+
+    fclose(f);
+}
+
+/*
+ * Read all the output of the scan
+ */
+
+static void drain(int fd, struct output *o)
+{
+    o->len = 0;
+
+    for (;;) {
+        struct pollfd pe;
+        ssize_t z;
+
+        if (o->len == o->size) {
+            o->size = o->size ? o->size * 2 : 1048576;
+            o->buf = realloc(o->buf, o->size);
+            if (o->buf == NULL) {
+                perror("realloc");
+                abort();
+            }
+        }
+
+        z = read(fd, o->buf + o->len, o->size - o->len);
+        if (z == 0)
+            break;
+
+        if (z == -1) {
+            if (errno != EAGAIN) {
+                perror("read");
+                abort();
+            }
+
+            pe.fd = fd;
+            pe.events = POLLIN;
+            if (poll(&pe, 1, -1) == -1)
+                abort();
+            continue;
+        }
+
+        o->len += z;
+    }
+
+    close(fd);
+}
+
+/*
+ * Scan with the script
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int script(const char *root, const char *manifest, struct output *o)
+{
+    int fd, status;
+    pid_t pid;
+
+    pid = fork_pipe(&fd, "./scan", "scan", root, manifest, NULL);
+    if (pid == -1)
+        return -1;
+
+    drain(fd, o);
+
+    if (waitpid(pid, &status, 0) == -1)
+        abort();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Scan with the built-in scanner
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int builtin(const char *root, const char *manifest,
+                   struct output *o)
+{
+    int fd;
+    struct scanner *s;
+
+    s = scanner_start(root, manifest, &fd);
+    if (s == NULL)
+        return -1;
+
+    drain(fd, o);
+
+    return scanner_join(s);
+}
+
+static int unlink_one(const char *path, const struct stat *st, int flag,
+                      struct FTW *ftw)
+{
+    if (remove(path) == -1)
+        perror(path);
+
+    return 0;
+}
+
+static int compar(const void *a, const void *b)
+{
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+/*
+ * Compare the output of two scans; the order of a directory is not
+ * defined, so the records are compared in sorted order
+ *
+ * Return: true if the same, otherwise false
+ */
+
+static bool same(struct output *a, struct output *b, size_t *records)
+{
+    struct output *o[2] = { a, b };
+    char **line[2];
+    size_t n[2], i;
+    bool r;
+
+    for (i = 0; i < 2; i++) {
+        char *x, *end;
+
+        line[i] = malloc(sizeof(char*) * (o[i]->len + 1));
+        if (line[i] == NULL) {
+            perror("malloc");
+            abort();
+        }
+
+        n[i] = 0;
+        end = o[i]->buf + o[i]->len;
+
+        for (x = o[i]->buf; x < end; ) {
+            char *eol;
+
+            eol = memchr(x, '\n', end - x);
+            if (eol == NULL)
+                break;
+
+            *eol = '\0';
+            line[i][n[i]++] = x;
+            x = eol + 1;
+        }
+
+        qsort(line[i], n[i], sizeof(char*), compar);
+    }
+
+    r = (n[0] == n[1]);
+
+    for (i = 0; r && i < n[0]; i++) {
+        if (strcmp(line[0][i], line[1][i]) != 0) {
+            fprintf(stderr, "'%s' != '%s'\n", line[0][i], line[1][i]);
+            r = false;
+        }
+    }
+
+    *records = n[0];
+
+    free(line[0]);
+    free(line[1]);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    char root[] = "/tmp/xwax-scan-bench-XXXXXX", *manifest;
+    size_t n, records;
+    int pass, failures;
+
+    n = (argc > 1) ? strtoul(argv[1], NULL, 10) : FILES;
+    failures = 0;
+
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    if (asprintf(&manifest, "%s.manifest", root) == -1)
+        abort();
+
+    synthesise(root, n, manifest);
+
+    printf("files\tscan\tscript_sec\tbuiltin_sec\trecords\n");
+
+    for (pass = 0; pass < 2; pass++) {
+        const char *m;
+        double start, a, b;
+        struct output x = { NULL, 0, 0 }, y = { NULL, 0, 0 };
+
+        m = pass ? manifest : NULL;
+
+        start = now();
+        if (script(root, m, &x) == -1) {
+            fprintf(stderr, "Scan script failed\n");
+            return EXIT_FAILURE;
+        }
+        a = now() - start;
+
+        start = now();
+        if (builtin(root, m, &y) == -1) {
+            fprintf(stderr, "Built-in scanner failed\n");
+            return EXIT_FAILURE;
+        }
+        b = now() - start;
+
+        if (!same(&x, &y, &records)) {
+            fprintf(stderr, "Scanners gave different records\n");
+            failures++;
+        }
+
+        printf("%zu\t%s\t%.3f\t%.3f\t%zu\n", n, pass ? "changes" : "full",
+               a, b, records);
+
+        free(x.buf);
+        free(y.buf);
+    }
+
+    if (getenv("KEEP")) { printf("%s\n", root); return 0; }
+    if (nftw(root, unlink_one, 16, FTW_DEPTH | FTW_PHYS) == -1)
+        perror("nftw");
+    if (unlink(manifest) == -1)
+        perror("unlink");
+    free(manifest);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
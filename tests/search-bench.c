@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of searching a large library
+ *
+ * Synthesise a library and type each query into it a character at a
+ * time, as the selector does, by scanning every record and using the
+ * trigram index. Output is one tab-separated line per query and sort
+ * order, suitable for comparison between builds.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "library.h"
+
+#define RECORDS 1000000
+#define BATCH 1024
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+static const char *syllables[] = {
+    "ka", "lo", "mi", "ra", "to", "ne", "su", "vi", "de", "po", "la", "ri",
+    "mo", "ta", "ki", "be", "an", "or", "el", "us", "str", "ph", "th", "ng",
+};
+
+static const char *queries[] = {
+    "kalo", "the", "mira tone", "strph", "su vi", "zz",
+};
+
+static const int sorts[] = { SORT_ARTIST, SORT_BPM, SORT_PLAYLIST };
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Append a random phrase of the given number of words
+ */
+
+static int phrase(char *buf, size_t len, int words)
+{
+    int n, w;
+
+    n = 0;
+
+    for (w = 0; w < words; w++) {
+        int s, syl;
+
+        if (w > 0)
+            n += snprintf(buf + n, len - n, " ");
+
+        syl = 2 + rand() % 2;
+        for (s = 0; s < syl; s++) {
+            n += snprintf(buf + n, len - n, "%s",
+                          syllables[rand() % ARRAY_SIZE(syllables)]);
+        }
+    }
+
+    return n;
+}
+
+static struct record* synthesise(size_t i)
+{
+    char buf[256];
+    struct record *x;
+    int len, a, t;
+
+    x = malloc(sizeof *x);
+    if (x == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    len = snprintf(buf, sizeof buf, "/music/%zu.mp3", i) + 1;
+    a = len;
+    len += phrase(buf + len, sizeof buf - len, 1 + rand() % 2) + 1;
+    t = len;
+    len += phrase(buf + len, sizeof buf - len, 1 + rand() % 4) + 1;
+
+    x->pathname = malloc(len);
+    if (x->pathname == NULL) {
+        perror("malloc");
+        abort();
+    }
+
+    memcpy(x->pathname, buf, len);
+    x->artist = x->pathname + a;
+    x->title = x->pathname + t;
+    x->match = NULL;
+    x->key = NULL;
+    x->bpm = (rand() % 4) ? 60.0 + rand() % 12000 / 100.0 : 0.0;
+
+    return x;
+}
+
+static void load(struct listing *l)
+{
+    size_t i, n;
+    struct record *batch[BATCH];
+
+    srand(1);
+
+    for (i = 0; i < RECORDS; i += n) {
+        for (n = 0; n < BATCH && i + n < RECORDS; n++)
+            batch[n] = synthesise(i + n);
+
+        if (listing_add_batch(l, batch, n) == -1)
+            abort();
+    }
+}
+
+static bool same_index(const struct index *a, const struct index *b)
+{
+    if (a->entries != b->entries)
+        return false;
+
+    return memcmp(a->record, b->record,
+                  sizeof(struct record*) * a->entries) == 0;
+}
+
+/*
+ * Search for the query, with both methods
+ *
+ * Return: false if the results were different, otherwise true
+ */
+
+static bool search(struct listing *l, int sort, struct index *src,
+                   const char *query, struct index *a, struct index *b,
+                   double *linear, double *trigram)
+{
+    double start;
+    struct match m;
+
+    match_compile(&m, query);
+
+    start = now();
+    if (index_match(src ? src : listing_index(l, sort), a, &m) == -1)
+        abort();
+    *linear = now() - start;
+
+    start = now();
+    if (listing_match(l, sort, src, b, &m) == -1)
+        abort();
+    *trigram = now() - start;
+
+    return same_index(a, b);
+}
+
+/*
+ * Type the query one character at a time, refining the previous
+ * result as the selector does, and time the slowest keystroke; only
+ * from three characters as the first keystrokes cannot use trigrams
+ */
+
+static bool type(struct listing *l, int sort, const char *query,
+                 double *linear, double *trigram)
+{
+    size_t n;
+    bool ok;
+    struct index a, b[2];
+
+    index_init(&a);
+    index_init(&b[0]);
+    index_init(&b[1]);
+
+    if (index_copy(listing_index(l, sort), &b[0]) == -1)
+        abort();
+
+    *linear = 0.0;
+    *trigram = 0.0;
+    ok = true;
+
+    for (n = 1; n <= strlen(query); n++) {
+        char buf[64];
+        double tl, tt;
+
+        memcpy(buf, query, n);
+        buf[n] = '\0';
+
+        if (!search(l, sort, &b[(n - 1) % 2], buf, &a, &b[n % 2], &tl, &tt))
+            ok = false;
+
+        if (n >= 3) {
+            if (tl > *linear)
+                *linear = tl;
+            if (tt > *trigram)
+                *trigram = tt;
+        }
+    }
+
+    index_clear(&a);
+    index_clear(&b[0]);
+    index_clear(&b[1]);
+
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int n, s, failures;
+    double start;
+    struct listing l;
+
+    failures = 0;
+
+    listing_init(&l);
+
+    start = now();
+    load(&l);
+    fprintf(stderr, "Loaded %d records in %.1fs\n", RECORDS, now() - start);
+
+    printf("records\tquery\tsort\tmatches\t"
+           "search_linear_ms\tsearch_trigram_ms\t"
+           "typing_linear_ms\ttyping_trigram_ms\n");
+
+    for (n = 0; n < ARRAY_SIZE(queries); n++) {
+        for (s = 0; s < ARRAY_SIZE(sorts); s++) {
+            double sl, st, tl, tt;
+            struct index a, b;
+            bool ok;
+
+            index_init(&a);
+            index_init(&b);
+
+            ok = search(&l, sorts[s], NULL, queries[n], &a, &b, &sl, &st);
+            if (!type(&l, sorts[s], queries[n], &tl, &tt))
+                ok = false;
+
+            if (!ok) {
+                fprintf(stderr, "'%s': trigram index gave a different result\n",
+                        queries[n]);
+                failures++;
+            }
+
+            printf("%d\t%s\t%d\t%zu\t%.2f\t%.2f\t%.2f\t%.2f\n",
+                   RECORDS, queries[n], sorts[s], b.entries,
+                   sl * 1000, st * 1000, tl * 1000, tt * 1000);
+
+            index_clear(&a);
+            index_clear(&b);
+        }
+    }
+
+    for (n = 0; n < l.by_order.entries; n++) {
+        free(l.by_order.record[n]->pathname);
+        free(l.by_order.record[n]);
+    }
+
+    listing_clear(&l);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Manual test of the snapshot of a listing
+ *
+ * Synthesise a crate of n records as if from a scan, save it and
+ * load it again into a separate library; the result must be the
+ * same. The times taken are given for comparison.
+ *
+ * The snapshot is kept in a temporary directory, not the user's
+ * cache, and removed afterwards.
+ */
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "library.h"
+#include "snapshot.h"
+
+#define BATCH 1024 /* records per batch, as the excrate */
+#define ARTISTS 16 /* records per artist, on average */
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Add n records to the storage and the listing, as the excrate
+ */
+
+static void scan(struct listing *storage, struct listing *l, size_t n)
+{
+    size_t i, z;
+    struct record *d[BATCH];
+
+    z = 0;
+
+    for (i = 0; i < n; i++) {
+        char line[256];
+
+        sprintf(line, "/music/%zu.mp3\tArtist %d\tTitle %d\t",
+                i, (int)(rand() % (n / ARTISTS + 1)), rand());
+
+        if (rand() % 4) /* otherwise unknown */
+            sprintf(line + strlen(line), "%d", 60 + rand() % 120);
+
+        d[z] = get_record(storage, line);
+        if (d[z] == NULL)
+            abort();
+
+        if (++z == BATCH || i == n - 1) {
+            if (listing_add_batch(storage, d, z) == -1)
+                abort();
+            if (listing_add_batch(l, d, z) == -1)
+                abort();
+            z = 0;
+        }
+    }
+}
+
+/*
+ * Remove the snapshots and the cache directory
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+static int cleanup(const char *cache)
+{
+    char path[4096];
+    DIR *d;
+    struct dirent *e;
+    int r;
+
+    r = 0;
+
+    snprintf(path, sizeof path, "%s/xwax", cache);
+
+    d = opendir(path);
+    if (d != NULL) {
+        while ((e = readdir(d)) != NULL) {
+            char file[8192];
+
+            if (e->d_name[0] == '.')
+                continue;
+
+            snprintf(file, sizeof file, "%s/%s", path, e->d_name);
+            if (unlink(file) == -1) {
+                perror(file);
+                r = -1;
+            }
+        }
+
+        closedir(d);
+
+        if (rmdir(path) == -1) {
+            perror(path);
+            r = -1;
+        }
+    }
+
+    if (rmdir(cache) == -1) {
+        perror(cache);
+        r = -1;
+    }
+
+    return r;
+}
+
+static bool same_index(const struct index *a, const struct index *b)
+{
+    size_t i;
+
+    if (a->entries != b->entries)
+        return false;
+
+    for (i = 0; i < a->entries; i++) {
+        const struct record *x = a->record[i], *y = b->record[i];
+
+        if (strcmp(x->pathname, y->pathname) != 0
+            || strcmp(x->artist, y->artist) != 0
+            || strcmp(x->title, y->title) != 0
+            || x->bpm != y->bpm)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n;
+    double start, scanned, saved, loaded;
+    struct listing storage, l, other, *x;
+    char cache[] = "/tmp/xwax-snapshot.XXXXXX";
+    bool removed, ok;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <records>\n", argv[0]);
+        return -1;
+    }
+
+    n = strtoul(argv[1], NULL, 10);
+
+    if (mkdtemp(cache) == NULL) {
+        perror("mkdtemp");
+        return -1;
+    }
+
+    if (setenv("XDG_CACHE_HOME", cache, 1) == -1) {
+        perror("setenv");
+        return -1;
+    }
+
+    if (library_global_init() == -1)
+        return -1;
+
+    listing_init(&storage);
+    listing_init(&l);
+    listing_init(&other);
+
+    start = now();
+    scan(&storage, &l, n);
+    scanned = now() - start;
+
+    start = now();
+    if (snapshot_save(&l, "test", "snapshot") == -1) {
+        cleanup(cache);
+        return -1;
+    }
+    saved = now() - start;
+
+    start = now();
+    x = snapshot_load(&other, "test", "snapshot");
+    removed = (cleanup(cache) == 0);
+    if (x == NULL)
+        return -1;
+    loaded = now() - start;
+
+    ok = removed
+        && same_index(&l.by_artist, &x->by_artist)
+        && same_index(&l.by_bpm, &x->by_bpm)
+        && same_index(&l.by_order, &x->by_order)
+        && same_index(&storage.by_artist, &other.by_artist);
+
+    printf("%zu records: parsed in %.3fs, saved in %.3fs, loaded in %.3fs\n",
+           n, scanned, saved, loaded);
+
+    if (!ok)
+        fprintf(stderr, "Snapshot gave a different listing\n");
+
+    listing_clear(x);
+    free(x);
+    listing_clear(&other);
+    listing_clear(&l);
+    listing_clear(&storage);
+    library_global_clear();
+
+    return ok ? 0 : -1;
+}
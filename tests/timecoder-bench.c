@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Offline benchmark of the timecoder's accuracy and throughput
+ *
+ * Synthesise timecode for each definition under a range of playback
+ * conditions, decode it and compare against the known signal. Output
+ * is one tab-separated line per scenario and pitch filter, suitable
+ * for comparison between builds.
+ */
+
+#define _GNU_SOURCE /* sincos() */
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "timecoder.h"
+
+#define STEREO 2
+#define RATE 48000 /* unless given by the scenario */
+#define PERIOD 64 /* samples per submission, like an audio device */
+#define DURATION 2.0 /* seconds of audio per scenario */
+#define SETTLE 0.5 /* seconds before pitch is measured */
+#define START 5.0 /* seconds into the timecode */
+#define STEP_AT 1.0 /* seconds until a change in pitch */
+#define STEP_WITHIN 0.1 /* proportion of a step considered a response */
+#define BAD 4 /* cycles of position error which count as wrong */
+
+#define LEVEL (SHRT_MAX * 0.5)
+#define WOW_HZ 0.55
+#define FLUTTER_HZ 6.5
+#define RUMBLE_HZ 12.0
+
+#define SQ(x) ((x)*(x))
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
+
+static const char *timecodes[] = {
+    "serato_2a", "serato_2b", "serato_cd",
+    "traktor_a", "traktor_b",
+    "mixvibes_v2", "mixvibes_7inch",
+    "pioneer_a", "pioneer_b",
+};
+
+/* Conditions under which the timecode is played */
+
+struct scenario {
+    double pitch, /* relative to reference speed; negative is reverse */
+        noise, /* amplitude of white noise, relative to the signal */
+        wow, /* depth of slow and fast variations in speed */
+        rumble; /* amplitude of low frequency rumble */
+    bool step; /* pitch changes abruptly at STEP_AT ... */
+    double to; /* ... to this value */
+    unsigned int rate; /* of the audio, if not RATE */
+    bool decimate; /* decode at a reduced rate */
+};
+
+static const struct scenario scenarios[] = {
+    { .pitch = 1.0 },
+    { .pitch = -1.0 },
+    { .pitch = 0.5 },
+    { .pitch = 2.0 },
+    { .pitch = -2.0 },
+    { .pitch = 1.0, .noise = 0.01 },
+    { .pitch = 1.0, .noise = 0.1 },
+    { .pitch = 1.0, .wow = 0.02 },
+    { .pitch = 1.0, .rumble = 0.2 },
+    { .pitch = 1.0, .noise = 0.01, .wow = 0.02, .rumble = 0.2 },
+    { .pitch = 1.0, .step = true, .to = 0.0 },
+    { .pitch = 1.0, .step = true, .to = -1.0 },
+    { .pitch = 0.5, .step = true, .to = 2.0 },
+    { .pitch = 1.0, .rate = 192000 },
+    { .pitch = 1.0, .rate = 192000, .decimate = true },
+    { .pitch = 1.0, .rate = 192000, .decimate = true, .step = true, .to = -1.0 },
+    { .pitch = 1.0, .rate = 96000, .decimate = true, .noise = 0.01,
+      .wow = 0.02, .rumble = 0.2 },
+};
+
+static const struct {
+    const char *name;
+    int filter;
+} filters[] = {
+    { "alpha_beta", PITCH_ALPHA_BETA },
+    { "kalman", PITCH_KALMAN },
+};
+
+/* Results of decoding one scenario */
+
+struct result {
+    double rate, /* samples per second through the timecoder */
+        lock, /* seconds until a position was first read */
+        locked, /* proportion of time with a valid position after lock */
+        bias, jitter, /* position error in seconds of timecode */
+        reverse, /* offset removed from positions read in reverse */
+        pitch, /* RMS error of the pitch, outside of any step */
+        latency, /* seconds for the pitch to respond to a step */
+        errors; /* proportion of bits in error, as reported */
+    unsigned int bad; /* positions which were wildly wrong */
+};
+
+static unsigned int scenario_rate(const struct scenario *sc)
+{
+    return sc->rate ? sc->rate : RATE;
+}
+
+/*
+ * Synthesis of the timecode signal, following the modulation used
+ * by mktimecode
+ */
+
+struct synth {
+    struct timecode_def *def;
+    const struct scenario *sc;
+    double phase; /* in cycles */
+    int cycle; /* cycle of the current bit */
+    bits_t code; /* LFSR at the current cycle */
+    unsigned long s; /* samples elapsed */
+    unsigned int rate;
+    unsigned int seed;
+};
+
+static void synth_init(struct synth *sy, struct timecode_def *def,
+                       const struct scenario *sc)
+{
+    int n;
+
+    sy->def = def;
+    sy->sc = sc;
+    sy->cycle = START * def->resolution;
+    sy->phase = sy->cycle + 0.5;
+    sy->s = 0;
+    sy->rate = scenario_rate(sc);
+    sy->seed = 0xbeefface;
+
+    sy->code = def->seed;
+    for (n = 0; n < sy->cycle; n++)
+        sy->code = lfsr_fwd(sy->code, def->taps, def->bits);
+}
+
+/*
+ * Return: the instantaneous pitch of the record at time t
+ */
+
+static double synth_pitch(const struct synth *sy, double t)
+{
+    const struct scenario *sc = sy->sc;
+    double pitch;
+
+    if (sc->step && t >= STEP_AT)
+        pitch = sc->to;
+    else
+        pitch = sc->pitch;
+
+    return pitch * (1.0 + sc->wow * sin(2 * M_PI * WOW_HZ * t)
+                        + sc->wow / 4 * sin(2 * M_PI * FLUTTER_HZ * t));
+}
+
+/*
+ * Return: approximately Gaussian noise, between -1.0 and 1.0
+ */
+
+static double synth_noise(struct synth *sy)
+{
+    int n;
+    double v;
+
+    v = 0.0;
+    for (n = 0; n < 4; n++) {
+        sy->seed = sy->seed * 1103515245 + 12345;
+        v += (double)(sy->seed >> 16) / 32768.0 - 1.0;
+    }
+
+    return v / 4;
+}
+
+static signed short to_pcm(double v)
+{
+    v *= LEVEL;
+
+    if (v > SHRT_MAX)
+        return SHRT_MAX;
+    if (v < SHRT_MIN)
+        return SHRT_MIN;
+    return (signed short)v;
+}
+
+/*
+ * Generate a block of stereo audio
+ *
+ * Bits are placed so that the decoder's bitstream is the LFSR value
+ * of the cycle currently being played; the position is in the
+ * same units as the lookup table.
+ */
+
+static void synth_pcm(struct synth *sy, signed short *pcm, size_t npcm)
+{
+    const struct timecode_def *def = sy->def;
+    const struct scenario *sc = sy->sc;
+
+    while (npcm--) {
+        double t, x, y, modulate, rumble, primary, secondary;
+        bits_t b;
+
+        t = (double)sy->s++ / sy->rate;
+        sy->phase += def->resolution * synth_pitch(sy, t) / sy->rate;
+
+        while ((int)floor(sy->phase) > sy->cycle) {
+            sy->code = lfsr_fwd(sy->code, def->taps, def->bits);
+            sy->cycle++;
+        }
+        while ((int)floor(sy->phase) < sy->cycle) {
+            sy->code = lfsr_rev(sy->code, def->taps, def->bits);
+            sy->cycle--;
+        }
+
+        b = sy->code >> (def->bits - 1);
+
+        sincos(sy->phase * M_PI * 2, &x, &y);
+
+        modulate = 1.0 - (-y + 1.0) * 0.25 * (b == 0);
+        primary = x * modulate;
+        secondary = y * modulate;
+        if (!(def->flags & SWITCH_PHASE))
+            secondary = -secondary;
+
+        rumble = sc->rumble * sin(2 * M_PI * RUMBLE_HZ * t);
+        primary += rumble + sc->noise * synth_noise(sy);
+        secondary += rumble + sc->noise * synth_noise(sy);
+
+        if (def->flags & SWITCH_PRIMARY) {
+            pcm[0] = to_pcm(primary);
+            pcm[1] = to_pcm(secondary);
+        } else {
+            pcm[0] = to_pcm(secondary);
+            pcm[1] = to_pcm(primary);
+        }
+
+        pcm += STEREO;
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        abort();
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Decode one scenario and measure the outcome
+ */
+
+static void run(struct timecode_def *def, const struct scenario *sc,
+                int filter, struct result *res)
+{
+    signed short pcm[PERIOD * STEREO];
+    unsigned int checks, valid, compared, measured, reversed;
+    unsigned long s, total;
+    double elapsed, sum, sum_sq, pitch_sq, responded;
+    struct synth sy;
+    struct timecoder tc;
+    struct timecoder_stats stats;
+    struct timecoder_quality quality;
+
+    synth_init(&sy, def, sc);
+    timecoder_init(&tc, def, 1.0, sy.rate, false, sc->decimate);
+    pitch_init(&tc.pitch, tc.dt, filter); /* override the default */
+
+    total = DURATION * sy.rate;
+    elapsed = 0.0;
+    res->lock = INFINITY;
+    res->bad = 0;
+
+    checks = 0;
+    valid = 0;
+    compared = 0;
+    measured = 0;
+    reversed = 0;
+    sum = 0.0;
+    sum_sq = 0.0;
+    pitch_sq = 0.0;
+    responded = STEP_AT;
+
+    for (s = 0; s < total; s += PERIOD) {
+        signed int r;
+        double t, start, when, pitch, offset, err;
+
+        synth_pcm(&sy, pcm, PERIOD);
+
+        start = now();
+        timecoder_submit(&tc, pcm, PERIOD);
+        elapsed += now() - start;
+
+        t = (double)(s + PERIOD) / sy.rate;
+        pitch = timecoder_get_pitch(&tc);
+
+        if (sc->step && t >= STEP_AT) {
+            if (fabs(pitch - sc->to) > fabs(sc->to - sc->pitch) * STEP_WITHIN)
+                responded = t;
+        }
+
+        if (t >= SETTLE && !(sc->step && t >= STEP_AT && t < STEP_AT + SETTLE)) {
+            pitch_sq += SQ(pitch - synth_pitch(&sy, t));
+            measured++;
+        }
+
+        r = timecoder_get_position(&tc, &when);
+
+        if (isfinite(res->lock))
+            checks++;
+
+        if (r == -1)
+            continue;
+
+        if (!isfinite(res->lock)) {
+            res->lock = t;
+            checks++;
+        }
+
+        valid++;
+
+        /* As for the pitch, the position is not compared while it
+         * settles after a step; the response is measured instead */
+
+        if (sc->step && t >= STEP_AT && t < STEP_AT + SETTLE)
+            continue;
+
+        /* In reverse the bitstream is the code at the far end of the
+         * bits read, bits - 1 cycles ahead; a known offset, which is
+         * reported rather than counted as error */
+
+        if (tc.forwards) {
+            offset = 0.0;
+        } else {
+            offset = def->bits - 1;
+            reversed++;
+        }
+
+        /* Compare with the player's view of the position */
+
+        compared++;
+        err = (r + pitch * when * def->resolution - sy.phase - offset)
+            / def->resolution;
+
+        if (fabs(err) > (double)BAD / def->resolution) {
+            res->bad++;
+            continue;
+        }
+
+        sum += err;
+        sum_sq += SQ(err);
+    }
+
+    res->rate = total / elapsed;
+    res->locked = checks ? (double)valid / checks : 0.0;
+    res->pitch = measured ? sqrt(pitch_sq / measured) : NAN;
+    res->latency = sc->step ? responded - STEP_AT : NAN;
+    res->reverse = reversed ? (double)(def->bits - 1) / def->resolution : 0.0;
+
+    memset(&stats, 0, sizeof stats);
+    timecoder_get_quality(&tc, &stats, &quality);
+    res->errors = quality.error_rate;
+
+    if (compared > res->bad) {
+        unsigned int n = compared - res->bad;
+
+        res->bias = sum / n;
+        res->jitter = sqrt(fmax(0.0, sum_sq / n - SQ(res->bias)));
+    } else {
+        res->bias = NAN;
+        res->jitter = NAN;
+    }
+
+    timecoder_clear(&tc);
+}
+
+/*
+ * A scenario without impairments must lock and track the position
+ */
+
+static bool acceptable(const struct scenario *sc, const struct result *res)
+{
+    if (sc->noise > 0.01)
+        return true;
+
+    return isfinite(res->lock) && res->bad == 0;
+}
+
+static bool selected(const char *name, int argc, char *argv[])
+{
+    int n;
+
+    if (argc == 1)
+        return true;
+
+    for (n = 1; n < argc; n++) {
+        if (strcmp(argv[n], name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int n, m, f, failures;
+
+    failures = 0;
+
+    printf("timecode\tfilter\tpitch\tstep_to\tnoise\twow\trumble\t"
+           "rate\tdecimate\t"
+           "samples_per_sec\tlock_ms\tlocked_pct\t"
+           "pos_bias_ms\tpos_jitter_ms\tpos_bad\treverse_offset_ms\t"
+           "pitch_rms\t"
+           "step_latency_ms\tbit_errors_pct\n");
+
+    for (n = 0; n < ARRAY_SIZE(timecodes); n++) {
+        struct timecode_def *def;
+
+        if (!selected(timecodes[n], argc, argv))
+            continue;
+
+        def = timecoder_find_definition(timecodes[n]);
+        if (def == NULL) {
+            fprintf(stderr, "Timecode '%s' is not available\n", timecodes[n]);
+            return EXIT_FAILURE;
+        }
+
+        for (m = 0; m < ARRAY_SIZE(scenarios); m++) {
+            const struct scenario *sc = &scenarios[m];
+
+            for (f = 0; f < ARRAY_SIZE(filters); f++) {
+                struct result res;
+
+                run(def, sc, filters[f].filter, &res);
+
+                printf("%s\t%s\t%+.2f\t%+.2f\t%.3f\t%.3f\t%.3f\t%u\t%d\t"
+                       "%.0f\t%.1f\t%.1f\t%+.3f\t%.3f\t%u\t%.1f\t%.5f\t%.1f\t"
+                       "%.2f\n",
+                       def->name, filters[f].name,
+                       sc->pitch, sc->step ? sc->to : sc->pitch,
+                       sc->noise, sc->wow, sc->rumble,
+                       scenario_rate(sc), sc->decimate,
+                       res.rate, res.lock * 1000, res.locked * 100,
+                       res.bias * 1000, res.jitter * 1000, res.bad,
+                       res.reverse * 1000,
+                       res.pitch, res.latency * 1000, res.errors * 100);
+
+                if (!acceptable(sc, &res)) {
+                    fprintf(stderr, "%s: scenario %d failed with %s\n",
+                            def->name, m, filters[f].name);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    timecoder_free_lookup();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
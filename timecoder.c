@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +40,7 @@
 
 #include "debug.h"
 #include "timecoder.h"
+#include "trace.h"
 
 #define ZERO_THRESHOLD (128 << 16)
 
@@ -54,15 +56,18 @@
 
 #define SCOPE_DECAY_EVERY 512 /* in samples */
 
+/* Sample rate which is enough to decode any timecode; input at
+ * multiples of this rate can be decimated */
+
+#define DECIMATE_RATE 44100
+
+#define OFFSET_RC 0.5 /* time constant for DC offset in statistics */
+
 #define SQ(x) ((x)*(x))
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
 
 /* Timecode definitions */
 
-#define SWITCH_PHASE 0x1 /* tone phase difference of 270 (not 90) degrees */
-#define SWITCH_PRIMARY 0x2 /* use left channel (not right) as primary */
-#define SWITCH_POLARITY 0x4 /* read bit values in negative (not positive) */
-
 static struct timecode_def timecodes[] = {
     {
         .name = "serato_2a",
@@ -163,37 +168,12 @@ static struct timecode_def timecodes[] = {
 };
 
 /*
- * Calculate LFSR bit
- */
-
-static inline bits_t lfsr(bits_t code, bits_t taps)
-{
-    bits_t taken;
-    int xrs;
-
-    taken = code & taps;
-    xrs = 0;
-    while (taken != 0x0) {
-        xrs += taken & 0x1;
-        taken >>= 1;
-    }
-
-    return xrs & 0x1;
-}
-
-/*
- * Linear Feedback Shift Register in the forward direction. New values
- * are generated at the least-significant bit.
+ * Linear Feedback Shift Register in the forward direction
  */
 
 static inline bits_t fwd(bits_t current, struct timecode_def *def)
 {
-    bits_t l;
-
-    /* New bits are added at the MSB; shift right by one */
-
-    l = lfsr(current, def->taps | 0x1);
-    return (current >> 1) | (l << (def->bits - 1));
+    return lfsr_fwd(current, def->taps, def->bits);
 }
 
 /*
@@ -202,13 +182,7 @@ static inline bits_t fwd(bits_t current, struct timecode_def *def)
 
 static inline bits_t rev(bits_t current, struct timecode_def *def)
 {
-    bits_t l, mask;
-
-    /* New bits are added at the LSB; shift left one and mask */
-
-    mask = (1 << def->bits) - 1;
-    l = lfsr(current, (def->taps >> 1) | (0x1 << (def->bits - 1)));
-    return ((current << 1) & mask) | l;
+    return lfsr_rev(current, def->taps, def->bits);
 }
 
 /*
@@ -300,17 +274,25 @@ static void init_channel(struct timecoder_channel *ch)
 {
     ch->positive = false;
     ch->zero = 0;
+    ch->last = 0;
+    ch->crossing_offset = 0.0;
 }
 
 /*
  * Initialise a timecode decoder at the given reference speed
  *
+ * If decimate is set, input at a high sample rate is filtered and
+ * decoded at a lower rate, which reduces the work per sample.
+ *
  * Return: -1 if the timecoder could not be initialised, otherwise 0
  */
 
 void timecoder_init(struct timecoder *tc, struct timecode_def *def,
-                    double speed, unsigned int sample_rate, bool phono)
+                    double speed, unsigned int sample_rate, bool phono,
+                    bool decimate)
 {
+    unsigned int factor;
+
     assert(def != NULL);
 
     /* A definition contains a lookup table which can be shared
@@ -320,7 +302,14 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
     tc->def = def;
     tc->speed = speed;
 
-    tc->dt = 1.0 / sample_rate;
+    if (decimate)
+        factor = decimator_factor(sample_rate, DECIMATE_RATE);
+    else
+        factor = 1;
+
+    decimator_init(&tc->decimator, factor);
+
+    tc->dt = (double)factor / sample_rate;
     tc->zero_alpha = tc->dt / (ZERO_RC + tc->dt);
     tc->threshold = ZERO_THRESHOLD;
     if (phono)
@@ -329,7 +318,7 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
     tc->forwards = 1;
     init_channel(&tc->primary);
     init_channel(&tc->secondary);
-    pitch_init(&tc->pitch, tc->dt);
+    pitch_init(&tc->pitch, tc->dt, PITCH_KALMAN);
 
     tc->ref_level = INT_MAX;
     tc->bitstream = 0;
@@ -338,6 +327,10 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
     tc->timecode_ticker = 0;
 
     tc->scope = NULL;
+
+    memset(&tc->acc, 0, sizeof tc->acc);
+    tc->stats = tc->acc;
+    tc->stats_seq = 0;
 }
 
 /*
@@ -383,6 +376,41 @@ int timecoder_scope(struct timecoder *tc, unsigned short size)
     return 0;
 }
 
+/*
+ * Release the raster display, so that another may be requested
+ *
+ * Pre: the realtime thread is not running, as it writes to the scope
+ */
+
+void timecoder_clear_scope(struct timecoder *tc)
+{
+    free(tc->scope);
+    tc->scope = NULL;
+}
+
+/*
+ * Interpolate the time at which the signal passed the given level,
+ * between the previous sample and this one
+ *
+ * Return: fraction of a sample before v, in the range 0.0 to 1.0
+ */
+
+static double crossing_offset(signed int last, signed int v, signed int level)
+{
+    double f;
+
+    if (v == last)
+        return 0.0;
+
+    f = ((double)v - level) / ((double)v - last);
+    if (f < 0.0)
+        return 0.0;
+    if (f > 1.0)
+        return 1.0;
+
+    return f;
+}
+
 /*
  * Update channel information with axis-crossings
  */
@@ -398,13 +426,18 @@ static void detect_zero_crossing(struct timecoder_channel *ch,
         ch->swapped = true;
         ch->positive = true;
         ch->crossing_ticker = 0;
+        ch->crossing_offset = crossing_offset(ch->last, v,
+                                              ch->zero + threshold);
     } else if (v < ch->zero - threshold && ch->positive) {
         ch->swapped = true;
         ch->positive = false;
         ch->crossing_ticker = 0;
+        ch->crossing_offset = crossing_offset(ch->last, v,
+                                              ch->zero - threshold);
     }
 
     ch->zero += alpha * (v - ch->zero);
+    ch->last = v;
 }
 
 /*
@@ -473,11 +506,15 @@ static void process_bitstream(struct timecoder *tc, signed int m)
         tc->bitstream = ((tc->bitstream << 1) & mask) + b;
     }
 
-    if (tc->timecode == tc->bitstream)
+    tc->acc.bits++;
+
+    if (tc->timecode == tc->bitstream) {
         tc->valid_counter++;
-    else {
+        tc->acc.last_valid = tc->acc.samples;
+    } else {
         tc->timecode = tc->bitstream;
         tc->valid_counter = 0;
+        tc->acc.errors++;
     }
 
     /* Take note of the last time we read a valid timecode */
@@ -527,6 +564,7 @@ static void process_sample(struct timecoder *tc,
         if (forwards != tc->forwards) { /* direction has changed */
             tc->forwards = forwards;
             tc->valid_counter = 0;
+            tc->acc.reversals++;
         }
     }
 
@@ -534,14 +572,20 @@ static void process_sample(struct timecoder *tc,
      * counters */
 
     if (!tc->primary.swapped && !tc->secondary.swapped)
-        pitch_dt_observation(&tc->pitch, 0.0);
+        pitch_dt_observation(&tc->pitch, 0.0, 0.0);
     else {
-        double dx;
+        double dx, ago;
 
         dx = 1.0 / tc->def->resolution / 4;
         if (!tc->forwards)
             dx = -dx;
-        pitch_dt_observation(&tc->pitch, dx);
+
+        if (tc->primary.swapped)
+            ago = tc->primary.crossing_offset * tc->dt;
+        else
+            ago = tc->secondary.crossing_offset * tc->dt;
+
+        pitch_dt_observation(&tc->pitch, dx, ago);
     }
 
     /* If we have crossed the primary channel in the right polarity,
@@ -558,6 +602,38 @@ static void process_sample(struct timecoder *tc,
     }
 
     tc->timecode_ticker++;
+
+    tc->acc.samples++;
+    if (tc->valid_counter > VALID_BITS)
+        tc->acc.locked++;
+}
+
+/*
+ * Make the signal statistics available to other threads, at the end
+ * of a block of npcm samples at the input rate
+ *
+ * There is only one writer, so readers retry if they see the sequence
+ * number change.
+ */
+
+static void publish_stats(struct timecoder *tc, size_t npcm)
+{
+    double elapsed, alpha;
+
+    elapsed = npcm * tc->dt / tc->decimator.factor;
+    alpha = elapsed / (OFFSET_RC + elapsed);
+
+    tc->acc.level = (double)tc->ref_level / (INT_MAX / 2);
+    tc->acc.offset[0] += alpha * ((double)tc->primary.zero / INT_MAX
+                                  - tc->acc.offset[0]);
+    tc->acc.offset[1] += alpha * ((double)tc->secondary.zero / INT_MAX
+                                  - tc->acc.offset[1]);
+
+    tc->stats_seq++;
+    __sync_synchronize();
+    tc->stats = tc->acc;
+    __sync_synchronize();
+    tc->stats_seq++;
 }
 
 /*
@@ -592,6 +668,25 @@ void timecoder_cycle_definition(struct timecoder *tc)
     tc->timecode_ticker = 0;
 }
 
+/*
+ * Return: a filtered sample value, in the same scale as the
+ * signed int used by the decoder
+ */
+
+static inline signed int to_int(float v)
+{
+    v *= 65536;
+
+    /* The filter can overshoot the original range */
+
+    if (v >= INT_MAX)
+        return INT_MAX;
+    if (v <= INT_MIN)
+        return INT_MIN;
+
+    return v;
+}
+
 /*
  * Submit and decode a block of PCM audio data to the timecode decoder
  *
@@ -600,11 +695,25 @@ void timecoder_cycle_definition(struct timecoder *tc)
 
 void timecoder_submit(struct timecoder *tc, signed short *pcm, size_t npcm)
 {
-    while (npcm--) {
+    size_t n;
+
+    trace_begin("timecoder_submit");
+
+    for (n = 0; n < npcm; n++, pcm += TIMECODER_CHANNELS) {
         signed int left, right, primary, secondary;
 
-        left = pcm[0] << 16;
-        right = pcm[1] << 16;
+        if (tc->decimator.factor == 1) {
+            left = pcm[0] << 16;
+            right = pcm[1] << 16;
+        } else {
+            float y[TIMECODER_CHANNELS];
+
+            if (!decimator_push(&tc->decimator, pcm, y))
+                continue;
+
+            left = to_int(y[0]);
+            right = to_int(y[1]);
+        }
 
         if (tc->def->flags & SWITCH_PRIMARY) {
             primary = left;
@@ -616,9 +725,11 @@ void timecoder_submit(struct timecoder *tc, signed short *pcm, size_t npcm)
 
         process_sample(tc, primary, secondary);
         update_scope(tc, left, right);
-
-        pcm += TIMECODER_CHANNELS;
     }
+
+    publish_stats(tc, npcm);
+
+    trace_end("timecoder_submit");
 }
 
 /*
@@ -644,8 +755,61 @@ signed int timecoder_get_position(struct timecoder *tc, double *when)
     if (r == -1)
         return -1;
 
-    if (when)
-        *when = tc->timecode_ticker * tc->dt;
+    /* The filter delays the signal, so the bit was read that much
+     * earlier than it was decoded */
+
+    if (when) {
+        *when = tc->timecode_ticker * tc->dt
+            + decimator_delay(&tc->decimator) * tc->dt / tc->decimator.factor;
+    }
 
     return r;
 }
+
+/*
+ * Take a consistent copy of the signal statistics
+ *
+ * This does not block the decoder, so is safe to call from any
+ * thread.
+ */
+
+void timecoder_get_stats(struct timecoder *tc, struct timecoder_stats *s)
+{
+    unsigned int seq;
+
+    do {
+        seq = tc->stats_seq;
+        __sync_synchronize();
+        *s = tc->stats;
+        __sync_synchronize();
+    } while (seq % 2 || seq != tc->stats_seq);
+}
+
+/*
+ * Calculate the signal quality since an earlier set of statistics
+ *
+ * Post: *since is updated to the current statistics, ready for the
+ * next interval
+ */
+
+void timecoder_get_quality(struct timecoder *tc, struct timecoder_stats *since,
+                           struct timecoder_quality *q)
+{
+    struct timecoder_stats now;
+    unsigned long samples, bits;
+
+    timecoder_get_stats(tc, &now);
+
+    samples = now.samples - since->samples;
+    bits = now.bits - since->bits;
+
+    q->error_rate = bits ? (double)(now.errors - since->errors) / bits : 0.0;
+    q->level = bits ? now.level : 0.0;
+    q->offset = fmax(fabs(now.offset[0]), fabs(now.offset[1]));
+    q->lock = samples ? (double)(now.locked - since->locked) / samples : 0.0;
+    q->reversals = samples ?
+        (now.reversals - since->reversals) / (samples * tc->dt) : 0.0;
+    q->since_valid = (now.samples - now.last_valid) * tc->dt;
+
+    *since = now;
+}
@@ -22,12 +22,18 @@
 
 #include <stdbool.h>
 
+#include "decimate.h"
+#include "lfsr.h"
 #include "lut.h"
 #include "pitch.h"
 
 #define TIMECODER_CHANNELS 2
 
-typedef unsigned int bits_t;
+/* Flags in a timecode definition */
+
+#define SWITCH_PHASE 0x1 /* tone phase difference of 270 (not 90) degrees */
+#define SWITCH_PRIMARY 0x2 /* use left channel (not right) as primary */
+#define SWITCH_POLARITY 0x4 /* read bit values in negative (not positive) */
 
 struct timecode_def {
     const char *name, *desc;
@@ -45,8 +51,34 @@ struct timecode_def {
 struct timecoder_channel {
     bool positive, /* wave is in positive part of cycle */
         swapped; /* wave recently swapped polarity */
-    signed int zero;
+    signed int zero, last; /* last is the previous sample value */
     unsigned int crossing_ticker; /* samples since we last crossed zero */
+    double crossing_offset; /* fraction of a sample since the crossing */
+};
+
+/* Counters describing the incoming signal, published by the decoder
+ * once per block of audio. Totals are since the decoder was
+ * initialised; levels are relative to full scale */
+
+struct timecoder_stats {
+    unsigned long samples, /* samples decoded */
+        locked, /* samples at which the position was valid */
+        bits, /* bits read from the signal */
+        errors, /* bits which did not follow the previous ones */
+        reversals, /* changes in direction */
+        last_valid; /* sample at which a bit last followed */
+    double level, /* amplitude of the signal */
+        offset[TIMECODER_CHANNELS]; /* DC offset, primary first */
+};
+
+/* Measures of signal quality over an interval */
+
+struct timecoder_quality {
+    double error_rate, /* proportion of bits in error */
+        level, offset, /* of the signal, relative to full scale */
+        lock, /* proportion of time the position was valid */
+        reversals, /* per second */
+        since_valid; /* seconds since a bit followed the sequence */
 };
 
 struct timecoder {
@@ -58,6 +90,10 @@ struct timecoder {
     double dt, zero_alpha;
     signed int threshold;
 
+    /* Input at a high sample rate is reduced before decoding */
+
+    struct decimator decimator;
+
     /* Pitch information */
 
     bool forwards;
@@ -77,21 +113,33 @@ struct timecoder {
     unsigned char *scope; /* x-y array */
     size_t scope_len; /* in bytes */
     unsigned short scope_size, scope_counter;
+
+    /* Signal quality; 'acc' is private to the decoding thread and
+     * copied to 'stats' at the end of each block for other threads */
+
+    struct timecoder_stats acc, stats;
+    unsigned int stats_seq; /* odd whilst stats are being written */
 };
 
 struct timecode_def* timecoder_find_definition(const char *name);
 void timecoder_free_lookup(void);
 
 void timecoder_init(struct timecoder *tc, struct timecode_def *def,
-                    double speed, unsigned int sample_rate, bool phono);
+                    double speed, unsigned int sample_rate, bool phono,
+                    bool decimate);
 void timecoder_clear(struct timecoder *tc);
 
 int timecoder_scope(struct timecoder *tc, unsigned short size);
+void timecoder_clear_scope(struct timecoder *tc);
 
 void timecoder_cycle_definition(struct timecoder *tc);
 void timecoder_submit(struct timecoder *tc, signed short *pcm, size_t npcm);
 signed int timecoder_get_position(struct timecoder *tc, double *when);
 
+void timecoder_get_stats(struct timecoder *tc, struct timecoder_stats *s);
+void timecoder_get_quality(struct timecoder *tc, struct timecoder_stats *since,
+                           struct timecoder_quality *q);
+
 /*
  * The timecode definition currently in use by this decoder
  */
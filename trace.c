@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Recording of trace events, and output in the Chrome trace event
+ * format; see trace.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+__thread struct trace_ring *trace_ring;
+
+static struct trace_ring *rings; /* every thread, newest first */
+static unsigned int threads;
+static const char *pathname;
+
+static int wake[2]; /* pipe from the signal handler to the dumper */
+static pthread_t dumper;
+
+/* Output is buffered for write(2) */
+
+struct out {
+    int fd;
+    size_t len;
+    char buf[4096];
+};
+
+/*
+ * Allocate the ring for the calling thread, and add it to the list
+ *
+ * Return: the ring, or NULL on error
+ */
+
+struct trace_ring* trace_new_ring(void)
+{
+    struct trace_ring *r;
+
+    r = calloc(1, sizeof *r);
+    if (r == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+
+    r->tid = __sync_add_and_fetch(&threads, 1);
+
+    do {
+        r->next = rings;
+    } while (!__sync_bool_compare_and_swap(&rings, r->next, r));
+
+    trace_ring = r;
+
+    return r;
+}
+
+static void flush(struct out *o)
+{
+    size_t done;
+
+    done = 0;
+    while (done < o->len) {
+        ssize_t z;
+
+        z = write(o->fd, o->buf + done, o->len - done);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        done += z;
+    }
+
+    o->len = 0;
+}
+
+static void put(struct out *o, const char *s)
+{
+    while (*s != '\0') {
+        if (o->len == sizeof o->buf)
+            flush(o);
+        o->buf[o->len++] = *s++;
+    }
+}
+
+/*
+ * Put an unsigned number, of at least the given number of digits
+ */
+
+static void put_number(struct out *o, unsigned long long v, int digits)
+{
+    char s[24], *p;
+
+    p = s + sizeof s;
+    *--p = '\0';
+
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+        digits--;
+    } while (v > 0 || digits > 0);
+
+    put(o, p);
+}
+
+/*
+ * Put the header common to all events
+ */
+
+static void put_event(struct out *o, const struct trace_ring *r,
+                      const char *name, const char *phase)
+{
+    put(o, "{\"name\":\"");
+    put(o, name);
+    put(o, "\",\"ph\":\"");
+    put(o, phase);
+    put(o, "\",\"pid\":");
+    put_number(o, getpid(), 1);
+    put(o, ",\"tid\":");
+    put_number(o, r->tid, 1);
+}
+
+/*
+ * Write the events recorded by each thread
+ *
+ * Threads continue to record during the output, so the most recent
+ * events in each ring may be incomplete.
+ */
+
+static void dump(void)
+{
+    bool first;
+    struct out o;
+    struct trace_ring *r;
+
+    o.fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (o.fd == -1) {
+        perror(pathname);
+        return;
+    }
+
+    o.len = 0;
+    first = true;
+
+    put(&o, "{\"traceEvents\":[\n");
+
+    for (r = rings; r != NULL; r = r->next) {
+        unsigned long head, n;
+
+        if (r->name != NULL) {
+            if (!first)
+                put(&o, ",\n");
+            first = false;
+
+            put_event(&o, r, "thread_name", "M");
+            put(&o, ",\"args\":{\"name\":\"");
+            put(&o, r->name);
+            put(&o, "\"}}");
+        }
+
+        head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        n = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0;
+
+        for (; n < head; n++) {
+            const struct trace_event *e;
+            char phase[2];
+
+            e = &r->event[n % TRACE_EVENTS];
+            phase[0] = e->phase;
+            phase[1] = '\0';
+
+            if (!first)
+                put(&o, ",\n");
+            first = false;
+
+            /* Timestamps are in microseconds */
+
+            put_event(&o, r, e->name, phase);
+            put(&o, ",\"ts\":");
+            put_number(&o, e->ns / 1000, 1);
+            put(&o, ".");
+            put_number(&o, e->ns % 1000, 3);
+            put(&o, "}");
+        }
+    }
+
+    put(&o, "\n]}\n");
+    flush(&o);
+
+    if (close(o.fd) == -1)
+        perror("close");
+}
+
+/*
+ * The signal can be taken by any thread, including a realtime one,
+ * so only wake the dumper
+ */
+
+static void handle(int signum)
+{
+    int saved;
+    char c = 'd';
+
+    saved = errno;
+    if (write(wake[1], &c, 1) == -1)
+        ; /* a dump is already pending */
+    errno = saved;
+}
+
+static void* launch(void *p)
+{
+    for (;;) {
+        ssize_t z;
+        char c;
+
+        z = read(wake[0], &c, 1);
+        if (z == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("read");
+            break;
+        }
+
+        if (z == 0)
+            break; /* trace_stop() */
+
+        dump();
+    }
+
+    return NULL;
+}
+
+/*
+ * Write the trace to the given path on SIGUSR1, and at trace_stop()
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+int trace_start(const char *path)
+{
+    int r;
+    struct sigaction sa;
+
+    if (pathname != NULL) {
+        fprintf(stderr, "Trace is already written to '%s'\n", pathname);
+        return -1;
+    }
+
+    if (pipe(wake) == -1) {
+        perror("pipe");
+        return -1;
+    }
+
+    /* A full pipe already has a dump pending */
+
+    if (fcntl(wake[1], F_SETFL, O_NONBLOCK) == -1) {
+        perror("fcntl");
+        goto fail;
+    }
+
+    r = pthread_create(&dumper, NULL, launch, NULL);
+    if (r != 0) {
+        errno = r;
+        perror("pthread_create");
+        goto fail;
+    }
+
+    pathname = path;
+
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = handle;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(SIGUSR1, &sa, NULL) == -1) {
+        perror("sigaction");
+        abort(); /* dumper is running */
+    }
+
+    fprintf(stderr, "Tracing to '%s' on SIGUSR1 and at exit\n", path);
+
+    return 0;
+
+fail:
+    if (close(wake[1]) == -1)
+        abort();
+    if (close(wake[0]) == -1)
+        abort();
+    return -1;
+}
+
+/*
+ * Stop responding to the signal and write the final trace, if
+ * trace_start() was successful
+ */
+
+void trace_stop(void)
+{
+    struct sigaction sa;
+
+    if (pathname == NULL)
+        return;
+
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(SIGUSR1, &sa, NULL) == -1)
+        abort();
+
+    if (close(wake[1]) == -1)
+        abort();
+    if (pthread_join(dumper, NULL) != 0)
+        abort();
+    if (close(wake[0]) == -1)
+        abort();
+
+    dump();
+}
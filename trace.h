@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Timeline of the hot paths across all threads, for finding the cause
+ * of a glitch; eg. an import burst, slow frame or late wake-up
+ *
+ * Build with TRACE=yes to enable. Each thread records into its own
+ * ring buffer of the most recent events, which is written as Chrome
+ * trace event JSON on SIGUSR1 and at exit, by a thread of its own.
+ * View it in a browser at chrome://tracing or https://ui.perfetto.dev/
+ *
+ * Otherwise the trace points compile to nothing.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef TRACE
+
+#include <time.h>
+
+#define TRACE_EVENTS 65536 /* per thread, a power of two */
+
+struct trace_event {
+    unsigned long long ns;
+    const char *name; /* static string */
+    char phase; /* 'B'egin or 'E'nd */
+};
+
+struct trace_ring {
+    struct trace_ring *next;
+    unsigned int tid;
+    const char *name;
+    unsigned long head; /* total events recorded */
+    struct trace_event event[TRACE_EVENTS];
+};
+
+extern __thread struct trace_ring *trace_ring;
+
+struct trace_ring* trace_new_ring(void);
+
+int trace_start(const char *path);
+void trace_stop(void);
+
+/*
+ * Record an event in the ring of the calling thread
+ *
+ * Events are dropped in a thread which has not called trace_thread();
+ * a ring is never allocated here, as this may be a realtime thread.
+ */
+
+static inline void trace_event(const char *name, char phase)
+{
+    struct trace_ring *r;
+    struct trace_event *e;
+    struct timespec ts;
+
+    r = trace_ring;
+    if (r == NULL)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    e = &r->event[r->head % TRACE_EVENTS];
+    e->ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    e->name = name;
+    e->phase = phase;
+
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Allocate the ring of the calling thread, when it starts
+ */
+
+static inline void trace_thread(const char *name)
+{
+    if (trace_ring == NULL && trace_new_ring() == NULL)
+        return;
+
+    trace_ring->name = name;
+}
+
+#define trace_begin(name) trace_event(name, 'B')
+#define trace_end(name) trace_event(name, 'E')
+
+#else
+
+#define trace_thread(name)
+#define trace_begin(name)
+#define trace_end(name)
+
+#endif
+
+#endif
@@ -31,6 +31,7 @@
 #include "realtime.h"
 #include "rig.h"
 #include "status.h"
+#include "trace.h"
 #include "track.h"
 
 #define RATE 44100
@@ -44,6 +45,10 @@
 static struct list tracks = LIST_INIT(tracks);
 static bool use_mlock = false;
 
+/* Totals since startup; protected by the rig lock */
+
+static unsigned long long imported, imports;
+
 /*
  * An empty track is used rarely, and is easier than
  * continuous checks for NULL throughout the code
@@ -70,6 +75,31 @@ void track_use_mlock(void)
     use_mlock = true;
 }
 
+/*
+ * Get the use of memory and the importer by all tracks
+ *
+ * Pre: rig lock is held
+ */
+
+void track_get_stats(struct track_stats *s)
+{
+    struct track *t;
+
+    s->tracks = 0;
+    s->importing = 0;
+    s->memory = 0;
+
+    list_for_each(t, &tracks, tracks) {
+        s->tracks++;
+        if (track_is_importing(t))
+            s->importing++;
+        s->memory += t->blocks * sizeof(struct track_block);
+    }
+
+    s->imported = imported;
+    s->imports = imports;
+}
+
 /*
  * Allocate more memory
  *
@@ -134,6 +164,30 @@ static void* access_pcm(struct track *tr, size_t *len)
     return (void*)tr->block[block]->pcm + fill;
 }
 
+/*
+ * Add a complete entry of the PPM meter to the peaks above it
+ *
+ * The first entry to arrive in each peak sets it, so the peaks need
+ * no initialisation, and each entry is added only once.
+ */
+
+static void add_peak(struct track_block *block, unsigned int n)
+{
+    int level;
+    unsigned char v;
+
+    v = block->ppm[n];
+
+    for (level = 1; level <= TRACK_PEAK_LEVELS; level++) {
+        unsigned char *p;
+
+        p = &track_peak_level(block, level)[n >> level];
+
+        if (n % (1 << level) == 0 || v > *p)
+            *p = v;
+    }
+}
+
 /*
  * Notify that audio has been placed in the buffer
  *
@@ -143,7 +197,7 @@ static void* access_pcm(struct track *tr, size_t *len)
 
 static void commit_pcm_samples(struct track *tr, unsigned int samples)
 {
-    unsigned int fill, n;
+    unsigned int fill, n, first;
     signed short *pcm;
     struct track_block *block;
 
@@ -186,6 +240,13 @@ static void commit_pcm_samples(struct track *tr, unsigned int samples)
         pcm += TRACK_CHANNELS;
     }
 
+    /* Entries of the PPM meter which are now complete */
+
+    first = (tr->length % TRACK_BLOCK_SAMPLES) / TRACK_PPM_RES;
+
+    for (n = first; n < fill / TRACK_PPM_RES; n++)
+        add_peak(block, n);
+
     /* Increment the track length. A memory barrier ensures the
      * realtime or UI thread does not access garbage audio */
 
@@ -201,6 +262,7 @@ static void commit_pcm_samples(struct track *tr, unsigned int samples)
 
 static void commit(struct track *tr, size_t len)
 {
+    imported += len;
     tr->bytes += len;
     commit_pcm_samples(tr, tr->bytes / SAMPLE - tr->length);
 }
@@ -454,6 +516,7 @@ static void stop_import(struct track *t)
     }
 
     t->pid = 0;
+    imports++;
 }
 
 /*
@@ -475,10 +538,13 @@ void track_handle(struct track *tr)
     if (tr->pe->revents == 0)
         return;
 
-    if (read_from_pipe(tr) != -1)
-        return;
+    trace_begin("track_handle");
+
+    if (read_from_pipe(tr) == -1) {
+        stop_import(tr);
+        list_del(&tr->rig);
+        track_release(tr); /* may delete the track */
+    }
 
-    stop_import(tr);
-    list_del(&tr->rig);
-    track_release(tr); /* may delete the track */
+    trace_end("track_handle");
 }
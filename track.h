@@ -31,12 +31,20 @@
 #define TRACK_MAX_BLOCKS 64
 #define TRACK_BLOCK_SAMPLES (2048 * 1024)
 #define TRACK_PPM_RES 64
+#define TRACK_PPM_BITS 6 /* log2 of TRACK_PPM_RES */
 #define TRACK_OVERVIEW_RES 2048
 
+/* Levels of peaks of the PPM meter; level n is the maximum over
+ * TRACK_PPM_RES << n samples. Each level is half the size of the one
+ * below, so together they are never larger than the ppm array */
+
+#define TRACK_PEAK_LEVELS 5
+
 struct track_block {
     signed short pcm[TRACK_BLOCK_SAMPLES * TRACK_CHANNELS];
     unsigned char ppm[TRACK_BLOCK_SAMPLES / TRACK_PPM_RES],
-        overview[TRACK_BLOCK_SAMPLES / TRACK_OVERVIEW_RES];
+        overview[TRACK_BLOCK_SAMPLES / TRACK_OVERVIEW_RES],
+        peak[TRACK_BLOCK_SAMPLES / TRACK_PPM_RES]; /* level 1 first */
 };
 
 struct track {
@@ -67,7 +75,18 @@ struct track {
     unsigned int overview;
 };
 
+/* Use of memory and the importer by all the tracks */
+
+struct track_stats {
+    unsigned int tracks, /* in memory */
+        importing; /* of those, still importing */
+    size_t memory; /* bytes allocated to audio */
+    unsigned long long imported, /* bytes of audio since startup */
+        imports; /* imports completed since startup */
+};
+
 void track_use_mlock(void);
+void track_get_stats(struct track_stats *s);
 
 /* Tracks are dynamically allocated and reference counted */
 
@@ -97,6 +116,38 @@ static inline unsigned char track_get_ppm(struct track *tr, int s)
     return b->ppm[(s % TRACK_BLOCK_SAMPLES) / TRACK_PPM_RES];
 }
 
+/* Return the position of the given level within the peaks of a
+ * block, for levels 1 to TRACK_PEAK_LEVELS */
+
+static inline unsigned char* track_peak_level(struct track_block *b,
+                                              int level)
+{
+    return b->peak + (sizeof b->ppm - (sizeof b->ppm >> (level - 1)));
+}
+
+/* Return the peak of the pseudo-PPM meter over the 2^scale samples
+ * from s, which is a multiple of 2^scale. Where the peak is not yet
+ * known (the end of the audio imported so far) this is the value at
+ * the given sample */
+
+static inline unsigned char track_get_peak(struct track *tr, int s,
+                                           int scale)
+{
+    struct track_block *b;
+    int level;
+
+    level = scale - TRACK_PPM_BITS;
+    if (level <= 0 || s + (1 << scale) > tr->length)
+        return track_get_ppm(tr, s);
+
+    if (level > TRACK_PEAK_LEVELS)
+        level = TRACK_PEAK_LEVELS;
+
+    b = tr->block[s / TRACK_BLOCK_SAMPLES];
+    return track_peak_level(b, level)
+        [(s % TRACK_BLOCK_SAMPLES) >> (TRACK_PPM_BITS + level)];
+}
+
 /* Return the overview meter value for the given sample */
 
 static inline unsigned char track_get_overview(struct track *tr, int s)
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * Trigram index of record text
+ *
+ * A search word can only be found in a record which contains every
+ * three-character sequence of that word, so the records to check are
+ * the intersection of those lists. Lists are hashed, so there may be
+ * false positives, which are removed using record_match().
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trigram.h"
+
+#define MIN_RECORDS 4096 /* below which a scan is quick enough */
+#define MIN_BITS 12
+#define MAX_BITS 16
+#define MAX_LISTS 64 /* per search; excess are not needed to be correct */
+
+void trigram_init(struct trigram *t)
+{
+    t->table = NULL;
+    t->bits = 0;
+    t->records = 0;
+    t->incomplete = false;
+}
+
+void trigram_clear(struct trigram *t)
+{
+    size_t n;
+
+    if (t->table == NULL)
+        return;
+
+    for (n = 0; n < (size_t)1 << t->bits; n++)
+        free(t->table[n].pos);
+
+    free(t->table);
+}
+
+/*
+ * Hash the trigram at the given text, folding case in the same way
+ * as strcasestr()
+ *
+ * Pre: at least three characters of text
+ */
+
+static unsigned int hash(const char *s, unsigned int bits)
+{
+    uint32_t x;
+
+    x = (uint32_t)tolower((unsigned char)s[0])
+        | (uint32_t)tolower((unsigned char)s[1]) << 8
+        | (uint32_t)tolower((unsigned char)s[2]) << 16;
+
+    return (x * 2654435761u) >> (32 - bits);
+}
+
+/*
+ * Append a record position to the list for the given bucket
+ *
+ * Return: 0 on success or -1 on memory allocation failure
+ */
+
+static int post(struct posting *p, uint32_t pos)
+{
+    if (p->entries > 0 && p->pos[p->entries - 1] == pos)
+        return 0; /* same trigram, or hash, already in this record */
+
+    if (p->entries == p->size) {
+        size_t size;
+        uint32_t *n;
+
+        size = p->size ? p->size * 2 : 4;
+        n = realloc(p->pos, sizeof *n * size);
+        if (n == NULL) {
+            perror("realloc");
+            return -1;
+        }
+
+        p->pos = n;
+        p->size = size;
+    }
+
+    p->pos[p->entries++] = pos;
+    return 0;
+}
+
+/*
+ * Return: 0 on success or -1 on memory allocation failure
+ */
+
+static int add_text(struct trigram *t, const char *s, uint32_t pos)
+{
+    for (; s[0] != '\0' && s[1] != '\0' && s[2] != '\0'; s++) {
+        if (post(&t->table[hash(s, t->bits)], pos) == -1)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Return: 0 on success or -1 on memory allocation failure
+ */
+
+static int add(struct trigram *t, const struct record *r, uint32_t pos)
+{
+    /* Index the same text which record_match() searches */
+
+    if (r->match)
+        return add_text(t, r->match, pos);
+
+    if (add_text(t, r->artist, pos) == -1)
+        return -1;
+
+    return add_text(t, r->title, pos);
+}
+
+/*
+ * Index the records which have been added to the listing since the
+ * last call
+ *
+ * A small listing is not indexed. Otherwise the table has around one
+ * list per record, up to a limit; as the listing grows the index is
+ * rebuilt at the larger size, which is rare.
+ *
+ * On memory allocation failure the index is marked as incomplete
+ * rather than returning an error; searches will fall back to
+ * scanning every record.
+ */
+
+void trigram_update(struct trigram *t, const struct index *by_order)
+{
+    unsigned int bits;
+
+    if (t->incomplete)
+        return;
+
+    if (by_order->entries < MIN_RECORDS)
+        return;
+
+    bits = MIN_BITS;
+    while (bits < MAX_BITS && (size_t)1 << bits < by_order->entries)
+        bits++;
+
+    if (t->table == NULL || bits > t->bits) {
+        trigram_clear(t);
+        trigram_init(t);
+
+        t->table = calloc((size_t)1 << bits, sizeof *t->table);
+        if (t->table == NULL) {
+            perror("calloc");
+            t->incomplete = true;
+            return;
+        }
+
+        t->bits = bits;
+    }
+
+    for (; t->records < by_order->entries; t->records++) {
+        if (add(t, by_order->record[t->records], t->records) == -1) {
+            t->incomplete = true;
+            return;
+        }
+    }
+}
+
+/*
+ * Gather the lists for every trigram of the search, shortest first
+ *
+ * Return: number of lists, or zero if the search has no trigrams
+ */
+
+static size_t gather(const struct trigram *t, const struct match *m,
+                     const struct posting **list)
+{
+    size_t n, i;
+    char *const *w;
+
+    n = 0;
+
+    for (w = m->words; *w != NULL; w++) {
+        const char *s;
+
+        for (s = *w; s[0] != '\0' && s[1] != '\0' && s[2] != '\0'; s++) {
+            const struct posting *p;
+
+            if (n == MAX_LISTS)
+                break;
+
+            p = &t->table[hash(s, t->bits)];
+
+            for (i = 0; i < n; i++) {
+                if (list[i] == p)
+                    break;
+            }
+            if (i < n)
+                continue; /* duplicate */
+
+            /* Insertion sort, by length */
+
+            for (i = n; i > 0 && list[i - 1]->entries > p->entries; i--)
+                list[i] = list[i - 1];
+            list[i] = p;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Return: an upper bound on the number of records which could match,
+ * or SIZE_MAX if the index cannot be used for this search
+ */
+
+size_t trigram_estimate(const struct trigram *t, const struct match *m)
+{
+    const struct posting *list[MAX_LISTS];
+
+    if (t->incomplete || t->table == NULL)
+        return SIZE_MAX;
+
+    if (gather(t, m, list) == 0)
+        return SIZE_MAX;
+
+    return list[0]->entries;
+}
+
+/*
+ * Search forwards in a sorted list for the given position
+ *
+ * Return: index of the first entry >= pos
+ */
+
+static size_t seek(const struct posting *p, size_t from, uint32_t pos)
+{
+    size_t lo, hi, step;
+
+    /* Gallop forwards to bound the search */
+
+    lo = from;
+    step = 1;
+    for (;;) {
+        hi = from + step;
+        if (hi >= p->entries) {
+            hi = p->entries;
+            break;
+        }
+        if (p->pos[hi] >= pos)
+            break;
+        lo = hi + 1;
+        step *= 2;
+    }
+
+    while (lo < hi) {
+        size_t mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (p->pos[mid] < pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/*
+ * Find entries of the listing which match, using the index
+ *
+ * Pre: trigram_estimate() did not return SIZE_MAX
+ * Pre: by_order is the listing which was added to this index
+ * Return: 0 on success, or -1 on memory allocation failure
+ * Post: dest contains the matching records, in the listing order
+ * Post: on failure, dest is valid but incomplete
+ */
+
+int trigram_match(const struct trigram *t, const struct index *by_order,
+                  struct index *dest, const struct match *m)
+{
+    size_t n, l, c, candidates;
+    uint32_t *cand;
+    const struct posting *list[MAX_LISTS];
+
+    assert(!t->incomplete);
+    assert(t->records == by_order->entries);
+
+    assert(t->table != NULL);
+
+    index_blank(dest);
+
+    n = gather(t, m, list);
+    assert(n > 0);
+
+    /* Intersect, starting with the shortest list */
+
+    candidates = list[0]->entries;
+    cand = malloc(sizeof *cand * (candidates + 1));
+    if (cand == NULL) {
+        perror("malloc");
+        return -1;
+    }
+
+    memcpy(cand, list[0]->pos, sizeof *cand * candidates);
+
+    for (l = 1; l < n && candidates > 0; l++) {
+        size_t k, at;
+
+        k = 0;
+        at = 0;
+
+        for (c = 0; c < candidates; c++) {
+            at = seek(list[l], at, cand[c]);
+            if (at == list[l]->entries)
+                break;
+            if (list[l]->pos[at] == cand[c])
+                cand[k++] = cand[c];
+        }
+
+        candidates = k;
+    }
+
+    /* Verify the candidates */
+
+    if (index_reserve(dest, candidates) == -1) {
+        free(cand);
+        return -1;
+    }
+
+    for (c = 0; c < candidates; c++) {
+        struct record *re;
+
+        re = by_order->record[cand[c]];
+        if (record_match(re, m))
+            index_add(dest, re);
+    }
+
+    free(cand);
+    return 0;
+}
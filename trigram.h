@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Mark Hills <mark@xwax.org>
+ *
+ * This file is part of "xwax".
+ *
+ * "xwax" is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 3 as
+ * published by the Free Software Foundation.
+ *
+ * "xwax" is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "index.h"
+
+/* Records are known by their position in the order they were added,
+ * and each trigram of text hashes to a list of these positions */
+
+struct posting {
+    uint32_t *pos;
+    size_t size, entries;
+};
+
+/* An index to quickly find the records which might match a search */
+
+struct trigram {
+    struct posting *table; /* or NULL if too few records to index */
+    unsigned int bits; /* of the hash; the table has 2^bits lists */
+    size_t records;
+    bool incomplete; /* ran out of memory, do not use */
+};
+
+void trigram_init(struct trigram *t);
+void trigram_clear(struct trigram *t);
+
+void trigram_update(struct trigram *t, const struct index *by_order);
+
+size_t trigram_estimate(const struct trigram *t, const struct match *m);
+int trigram_match(const struct trigram *t, const struct index *by_order,
+                  struct index *dest, const struct match *m);
+
+#endif
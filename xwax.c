@@ -30,14 +30,18 @@
 #include "device.h"
 #include "dicer.h"
 #include "dummy.h"
+#include "file.h"
 #include "interface.h"
 #include "jack.h"
 #include "library.h"
+#include "metrics.h"
 #include "oss.h"
+#include "pool.h"
 #include "realtime.h"
 #include "thread.h"
 #include "rig.h"
 #include "timecoder.h"
+#include "trace.h"
 #include "track.h"
 #include "xwax.h"
 
@@ -46,6 +50,8 @@
 
 #define DEFAULT_ALSA_BUFFER 240 /* samples */
 
+#define DEFAULT_FILE_PERIOD 256 /* samples */
+
 #define DEFAULT_PRIORITY 80
 
 #define DEFAULT_IMPORTER EXECDIR "/xwax-import"
@@ -58,7 +64,7 @@ char *banner = "xwax " VERSION \
     " (C) Copyright 2026 Mark Hills <mark@xwax.org>";
 
 size_t ndeck;
-struct deck deck[3];
+struct deck deck[MAX_DECKS];
 
 static size_t nctl;
 static struct controller ctl[2];
@@ -66,7 +72,7 @@ static struct controller ctl[2];
 static struct rt rt;
 
 static double speed;
-static bool protect, phono;
+static bool protect, phono, decimate;
 static const char *importer;
 static struct timecode_def *timecode;
 
@@ -79,12 +85,17 @@ static void usage(FILE *fd)
       "  --rtprio <n>        Real-time priority (0 for no priority, default %d)\n"
       "  --geometry <s>      Set display geometry (see man page)\n"
       "  --no-decor          Request a window with no decorations\n"
+      "  --metrics <path>    Serve a snapshot of metrics on a local socket\n"
+#ifdef TRACE
+      "  --trace <path>      Write a trace on SIGUSR1 and at exit\n"
+#endif
       "  -h, --help          Display this message to stdout and exit\n\n",
       DEFAULT_PRIORITY);
 
     fprintf(fd, "Music library options:\n"
       "  -l, --crate <path>  Location to scan for audio tracks\n"
-      "  --scan <program>    Library scanner (default '%s')\n\n",
+      "  --scan <program>    Library scanner (default '%s')\n"
+      "  --scan builtin      Use the scanner within xwax\n\n",
       DEFAULT_SCANNER);
 
     fprintf(fd, "Deck options:\n"
@@ -94,10 +105,18 @@ static void usage(FILE *fd)
       "  --[no-]protect      Protect against certain operations while playing\n"
       "  --line              Line level signal (default)\n"
       "  --phono             Tolerate cartridge level signal ('software pre-amp')\n"
+      "  --[no-]decimate     Decode timecode at a reduced sample rate\n"
       "  --import <program>  Track importer (default '%s')\n"
       "  --dummy             Build a dummy deck with no audio device\n\n",
       DEFAULT_IMPORTER);
 
+    fprintf(fd, "File device options:\n"
+      "  --file <path>       Build a deck with input from a WAV or raw file\n"
+      "  --output <path>     Write audio from the next file deck to a raw file\n"
+      "  --period <n>        Period size (default %d samples)\n"
+      "  --rate <hz>         Sample rate of raw audio (default 44100Hz)\n\n",
+      DEFAULT_FILE_PERIOD);
+
 #ifdef WITH_OSS
     fprintf(fd, "OSS device options:\n"
       "  --oss <device>      Build a deck connected to OSS audio device\n"
@@ -174,7 +193,7 @@ static int commit_deck(void)
 
     d = &deck[ndeck];
 
-    r = deck_init(d, &rt, timecode, importer, speed, phono, protect);
+    r = deck_init(d, &rt, timecode, importer, speed, phono, decimate, protect);
     if (r == -1)
         return -1;
 
@@ -191,15 +210,15 @@ static int commit_deck(void)
 int main(int argc, const char *argv[])
 {
     int rc = -1, n, priority;
-    const char *scanner, *geo;
+    const char *scanner, *geo, *metrics;
     char *endptr;
     bool use_mlock, decor;
 
     struct library library;
 
-#if defined WITH_OSS || WITH_ALSA
     unsigned int rate;  /* or 0 for 'automatic' */
-#endif
+    unsigned int file_period;
+    const char *file_output;
 
 #ifdef WITH_OSS
     int oss_buffers, oss_fragment;
@@ -226,6 +245,8 @@ int main(int argc, const char *argv[])
 
     if (thread_global_init() == -1)
         return -1;
+    if (pool_global_init(0) == -1)
+        return -1;
     if (library_global_init() == -1)
         return -1;
 
@@ -237,6 +258,7 @@ int main(int argc, const char *argv[])
     ndeck = 0;
     geo = "";
     decor = true;
+    metrics = NULL;
     nctl = 0;
     priority = DEFAULT_PRIORITY;
     importer = DEFAULT_IMPORTER;
@@ -245,11 +267,12 @@ int main(int argc, const char *argv[])
     speed = 1.0;
     protect = false;
     phono = false;
+    decimate = false;
     use_mlock = false;
 
-#if defined WITH_OSS || WITH_ALSA
     rate = 0; /* automatic */
-#endif
+    file_period = DEFAULT_FILE_PERIOD;
+    file_output = NULL;
 
 #ifdef WITH_ALSA
     alsa_buffer = DEFAULT_ALSA_BUFFER;
@@ -335,7 +358,6 @@ int main(int argc, const char *argv[])
             argc -= 2;
 #endif
 
-#if defined WITH_OSS || WITH_ALSA
         } else if (!strcmp(argv[0], "--rate") || !strcmp(argv[0], "-r")) {
 
             if (!strcmp(argv[0], "-r"))
@@ -361,7 +383,6 @@ int main(int argc, const char *argv[])
 
             argv += 2;
             argc -= 2;
-#endif
 
 #ifdef WITH_ALSA
         } else if (!strcmp(argv[0], "-m")) {
@@ -454,6 +475,61 @@ int main(int argc, const char *argv[])
             argv++;
             argc--;
 
+        } else if (!strcmp(argv[0], "--file")) {
+
+            struct device *v;
+
+            if (argc < 2) {
+                fprintf(stderr, "%s requires a pathname as an argument.\n",
+                        argv[0]);
+                return -1;
+            }
+
+            v = start_deck(argv[1]);
+            if (v == NULL)
+                return -1;
+
+            if (file_init(v, argv[1], file_output, rate, file_period) == -1)
+                return -1;
+            commit_deck();
+
+            file_output = NULL; /* applies to one deck only */
+
+            argv += 2;
+            argc -= 2;
+
+        } else if (!strcmp(argv[0], "--output")) {
+
+            if (argc < 2) {
+                fprintf(stderr, "%s requires a pathname as an argument.\n",
+                        argv[0]);
+                return -1;
+            }
+
+            file_output = argv[1];
+
+            argv += 2;
+            argc -= 2;
+
+        } else if (!strcmp(argv[0], "--period")) {
+
+            /* Set the period of subsequent file devices */
+
+            if (argc < 2) {
+                fprintf(stderr, "--period requires an integer argument.\n");
+                return -1;
+            }
+
+            file_period = strtoul(argv[1], &endptr, 10);
+            if (*endptr != '\0' || file_period == 0) {
+                fprintf(stderr, "--period requires a positive integer "
+                        "argument.\n");
+                return -1;
+            }
+
+            argv += 2;
+            argc -= 2;
+
         } else if (!strcmp(argv[0], "--timecode")) {
 
             /* Set the timecode definition to use */
@@ -514,6 +590,20 @@ int main(int argc, const char *argv[])
             argv++;
             argc--;
 
+        } else if (!strcmp(argv[0], "--decimate")) {
+
+            decimate = true;
+
+            argv++;
+            argc--;
+
+        } else if (!strcmp(argv[0], "--no-decimate")) {
+
+            decimate = false;
+
+            argv++;
+            argc--;
+
         } else if (!strcmp(argv[0], "--lock-ram")) {
 
             use_mlock = true;
@@ -556,6 +646,35 @@ int main(int argc, const char *argv[])
             argv += 2;
             argc -= 2;
 
+        } else if (!strcmp(argv[0], "--metrics")) {
+
+            if (argc < 2) {
+                fprintf(stderr, "%s requires a pathname as an argument.\n",
+                        argv[0]);
+                return -1;
+            }
+
+            metrics = argv[1];
+
+            argv += 2;
+            argc -= 2;
+
+#ifdef TRACE
+        } else if (!strcmp(argv[0], "--trace")) {
+
+            if (argc < 2) {
+                fprintf(stderr, "%s requires a pathname as an argument.\n",
+                        argv[0]);
+                return -1;
+            }
+
+            if (trace_start(argv[1]) == -1)
+                return -1;
+
+            argv += 2;
+            argc -= 2;
+#endif
+
         } else if (!strcmp(argv[0], "--no-decor")) {
 
             decor = false;
@@ -689,17 +808,27 @@ int main(int argc, const char *argv[])
         }
     }
 
-    if (rig_main() == -1)
+    if (metrics != NULL && metrics_start(metrics, &library) == -1)
         goto out_interface;
 
+    if (rig_main() == -1)
+        goto out_metrics;
+
     rc = EXIT_SUCCESS;
     fprintf(stderr, "Exiting cleanly...\n");
 
+out_metrics:
+    if (metrics != NULL)
+        metrics_stop();
 out_interface:
     interface_stop();
 out_rt:
     rt_stop(&rt);
 
+#ifdef TRACE
+    trace_stop();
+#endif
+
     for (n = 0; n < ndeck; n++)
         deck_clear(&deck[n]);
 
@@ -711,6 +840,7 @@ out_rt:
     rt_clear(&rt);
     rig_clear();
     library_global_clear();
+    pool_global_clear();
     thread_global_clear();
 
     if (rc == EXIT_SUCCESS)
@@ -30,7 +30,9 @@ extern char *banner;
   "free software, and you are welcome to redistribute it under certain\n"\
   "conditions; see the file COPYING for details."
 
+#define MAX_DECKS 3
+
 extern size_t ndeck;
-extern struct deck deck[];
+extern struct deck deck[MAX_DECKS];
 
 #endif